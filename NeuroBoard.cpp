@@ -42,479 +42,1895 @@
 #define I_SHIFT_CLOCK_PIN  B11111101
 #define SHIFT_DATA_PIN     B00001000                        // serial data pin for shift register SER - PB3
 #define I_SHIFT_DATA_PIN   B11110111
-#define BITMASK_ONE        B00000001
+#define BITMASK_ONE        B00000001                        // relay pin RELAY_PIN (D3) is PD0 on the Leonardo
 #define I_BITMASK_ONE      B11111110
 
 /* ******************************************************* */
 
 /// PRIVATE FUNCTIONS ///
 
+// Button Variables, index 0 is RED_BTN and 1 is WHITE_BTN //
+
+Gesture gestures[MAX_GESTURES];
+uint8_t gestureCount = 0;
+ButtonState buttonState[BUTTON_COUNT];      // Gesture state, loop() only
+uint8_t buttonsDown = 0;                    // Mask of buttons held, loop() only
+StaticRingBuffer<ButtonEvent, BUTTON_QUEUE_SIZE, DROP_NEWEST> buttonQueue;    // Debounced edges waiting for handleInputs
+volatile bool buttonReported[BUTTON_COUNT]; // Last state queued, interrupts only
+volatile ulong buttonEdgeTime[BUTTON_COUNT];// When it was queued
+bool buttonsStarted = false;
+bool buttonTimersPending = false;           // A long press or double press is being timed
+
+// Trigger Variables //
+
+Trigger triggers[MAX_TRIGGERS];             // Checked in order, disabled entries are free
+uint8_t triggerCount = 0;                   // Entries in use, including disabled ones in between
+StaticRingBuffer<TriggerEvent, TRIGGER_QUEUE_SIZE, DROP_NEWEST> triggerQueue;  // Crossings waiting for handleInputs
+TriggerEvent lastTriggerEvent = TriggerEvent();
+
+// Servo Variable //
+
+NeuroServo servo = NeuroServo();
+volatile bool servoEnabled = false;
+uint16_t servoSlewRate = SERVO_SLEW_RATE;   // Degrees per second, 0 for no limit
+uint8_t servoDeadband = GRIPPER_MINIMUM_STEP; // Degrees
+volatile uint8_t servoInput = SERVO_ENVELOPE_INPUT;
+uint16_t servoFrameTicks = 1;               // Sample ticks per servo frame, see servoTiming
+uint16_t servoSlewStep = 0;                 // Most the pulse width moves per frame (us), 0 for no limit
+uint16_t servoDeadbandWidth = 0;            // Dead zone as a pulse width (us)
+MapKernel angleToPulse = MapKernel(0, 180, MIN_PULSE_WIDTH, MAX_PULSE_WIDTH);  // Same as Servo::write
+ServoStats servoStats = ServoStats();        // Latencies in TCNT3 ticks, getServoStats converts them
+bool emgStrengthEnabled = false;
+
+// Mapping backend state, kept out of NeuroServo so its layout is the same for every SERVO_MAPPING //
+
+#if SERVO_MAPPING == TABLE_MAPPING
+const SensitivityTables openTables PROGMEM = sensitivityTables(40, 190, 105);      // OPEN_MODE angles
+const SensitivityTables closedTables PROGMEM = sensitivityTables(120, 105, 190);   // CLOSED_MODE angles
+const SensitivityTables ledbarTables PROGMEM = sensitivityTables(30, 0, MAX_LEDS); // LED bar heights
+uint8_t mapLevel = SENSITIVITY_LEVELS - 1;  // Level of the tables that matches emgSaturationValue
+#else
+MapKernel openMap = MapKernel(40, 1024, 190, 105);      // EMG to angle in OPEN_MODE, follows emgSaturationValue
+MapKernel closedMap = MapKernel(120, 1024, 105, 190);   // EMG to angle in CLOSED_MODE
+MapKernel ledbarMap = MapKernel(30, 1024, 0, MAX_LEDS); // EMG to LED bar height
+#endif
+
+int NeuroBoard::decayRate = 1;
+
+// Buffer Variables //
+
+RingBuffer<int16_t, SAMPLE_OVERRUN_POLICY> buffer[MAX_CHANNELS];    // One buffer per scanned channel, bound in startMeasurements
+
+// Envelope Values //
+
+int envelopeValue[MAX_CHANNELS];
+int32_t envelopeAcc[MAX_CHANNELS];          // Filter state of the envelope engine, see NeuroDSP.hpp
+volatile uint8_t envelopeEngine = PEAK_DECAY_ENVELOPE;
+uint16_t envelopeMs = 100;
+uint8_t envelopeShift = 0;                  // Time constant as a shift, follows the sample rate
+int16_t envelopeZero = 0;
+
+// Mains notch filter, see setNotchFilter //
+
+Biquad notch[MAX_CHANNELS];
+BiquadCoefficients notchKernel = BiquadCoefficients();
+volatile uint8_t mainsFrequency = 0;        // Frequency being notched, 0 when off
+volatile bool mainsCalibrating = false;     // NOTCH_AUTO measurement running
+volatile bool mainsCalibrated = false;      // NOTCH_AUTO measurement done, frequency not picked yet
+MainsDetector mainsDetector;
+
+// User filter, see setSampleFilter //
+
+int16_t (*sampleFilter)(uint8_t slot, int16_t sample) = nullptr;
+
+// Window statistics of slot 0, see setWindowSize //
+
+SlidingWindow<WINDOW_MAX_SIZE> window;
+
+// Decimation of slot 0, see setDecimation //
+
+CicDecimator<CIC_ORDER> decimator;
+StaticRingBuffer<int16_t, DECIMATED_BUFFER_SIZE, SAMPLE_OVERRUN_POLICY> decimatedBuffer;
+bool decimating = false;
+
+// Scan Variables //
+
+uint8_t scanChannels[MAX_CHANNELS] = {A0};  // Channels sampled every tick, slot 0 is NeuroBoard::channel
+uint8_t scanMux[MAX_CHANNELS];              // ADC multiplexer value for each slot
+uint8_t scanCount = 1;
+volatile uint8_t scanIndex = 0;             // Slot being converted (ASYNC_SAMPLING only)
+
+// Serial variable, changed in startCommunication method //
+
+bool communicate = false;
+uint8_t NeuroBoard::channel = A0;
+
+// Sample variable //
+
+int reading;
+
+// Sampling mode variables //
+
+volatile uint8_t samplingMode = BLOCKING_SAMPLING;
+volatile uint16_t timerCycles = 0;          // Cycles spent in TIMER3_COMPA_vect (ASYNC_SAMPLING only)
+volatile uint16_t isrCycles = 0;            // Cycles spent handling the last sample
+
+// Streaming variables //
+
+volatile uint8_t streamingMode = 0;         // 0 (off), LOOP_STREAMING or ISR_STREAMING
+StreamStats streamStats = StreamStats();
+
+#if TX_BUFFER_SIZE > 0
+StaticRingBuffer<uint8_t, TX_BUFFER_SIZE, DROP_NEWEST> txBuffer;   // Encoded bytes waiting for Serial (ISR_STREAMING only)
+bool frameQueued = false;                   // Whether the frame being sampled fit in txBuffer
+uint8_t ticksSincePump = 0;
+uint8_t pumpInterval = 1;                   // Ticks per millisecond, at least 1
+#endif
+
+// Acquisition health variables //
+
+AcquisitionStats stats = AcquisitionStats();
+uint32_t avgCyclesQ4 = 0;                   // Running average of isrCycles, scaled by 16
+
+// Sample rate variables //
+
+uint16_t timerPrescaler = sampleRatePrescaler(DEFAULT_SAMPLE_RATE);
+uint16_t timerTop = sampleRateTop(DEFAULT_SAMPLE_RATE, timerPrescaler);
+uint8_t timerShift = 0;                     // log2(timerPrescaler), converts TCNT3 ticks to cycles
+bool timerStarted = false;
+
+// LED shift register transfer, see NEUROBOARD_LED_SPI //
+
+#if defined(NEUROBOARD_LED_SPI) && defined(NEUROBOARD_LED_SPI_INTERRUPT)
+volatile bool ledTransferring = false;      // SPDR is shifting a byte out
+volatile bool ledQueued = false;            // Another byte is waiting for the transfer to end
+volatile byte ledQueuedByte = 0;
+#endif
+
+// Relay pulse generator, see setRelayPulse //
+
+ulong relayWidthUs = RELAY_PULSE_US;
+ulong relayIntervalUs = 0;
+uint8_t relayCount = 1;
+uint16_t relayWidthTicks = sampleTicks(RELAY_PULSE_US, timerPrescaler, timerTop);    // Times rounded to sample ticks, follow the sample rate
+uint16_t relayIntervalTicks = 1;
+volatile bool relayRunning = false;
+bool relayOn = false;                       // Pin state, sample interrupt only while running
+uint8_t relayPulsesLeft = 0;                // 0 repeats until stopRelay
+uint16_t relayTicksLeft = 0;                // Ticks until the pin changes
+
+/**
+ * Returns the ADC multiplexer value for the passed analog pin, the same way analogRead() does.
+**/
+uint8_t adcMux(uint8_t pin) {
+
+    if (pin >= A0) pin -= A0; // Allow for channel or pin numbers
+
+    #ifdef analogPinToChannel
+        pin = analogPinToChannel(pin);
+    #endif
+
+    return pin;
+
+}
+
+/**
+ * Points the ADC multiplexer at the passed value from adcMux().
+ * Only needed in ASYNC_SAMPLING mode, where analogRead() is never called.
+**/
+inline void selectADCInput(const uint8_t& mux) {
+
+    #if defined(ADCSRB) && defined(MUX5)
+        ADCSRB = (ADCSRB & ~_BV(MUX5)) | (((mux >> 3) & 0x01) << MUX5);
+    #endif
+
+    ADMUX = _BV(REFS0) | (mux & 0x07); // AVcc reference, same as analogReference(DEFAULT)
+
+}
+
+/**
+ * Returns the scan slot sampling the passed channel, or -1 if it isn't scanned.
+**/
+int8_t channelSlot(uint8_t channel) {
+
+    if (channel >= A0) channel -= A0;
+
+    for (uint8_t slot = 0; slot < scanCount; slot++) {
+        if (scanChannels[slot] - A0 == channel) return slot;
+    }
+
+    return -1;
+
+}
+
+/**
+ * Returns the scan slot a trigger's channel is sampled in, or -1.
+**/
+int8_t triggerSlot(const uint8_t& channel) {
+
+    return (channel == PRIMARY_CHANNEL) ? 0 : channelSlot(channel);
+
+}
+
+/**
+ * Stream encoding, see startStreaming. Two 7 bit bytes per sample, the top bit
+ * of the first byte marks the start of a frame.
+**/
+inline uint8_t encodeHigh(const int16_t& sample, const bool& frameStart) {
+    return ((sample >> 7) & 0x7F) | (frameStart ? 0x80 : 0x00);
+}
+
+inline uint8_t encodeLow(const int16_t& sample) {
+    return sample & 0x7F;
+}
+
+/**
+ * Measures mains hum for NOTCH_AUTO.
+**/
+inline void calibrateMains(const int16_t& sample) {
+
+    if (mainsDetector.push(sample)) {
+        mainsCalibrating = false;
+        mainsCalibrated = true;
+    }
+
+}
+
+/**
+ * Filters the new reading, calculates the envelope value and places it in the
+ * slot's buffer. Shared by both sampling modes.
+**/
+inline void storeSample(const uint8_t& slot, int sample) {
+
+    if (mainsCalibrating && slot == 0) calibrateMains(sample);
+
+    if (mainsFrequency || sampleFilter) {
+        if (mainsFrequency) sample = notch[slot].process(sample, notchKernel);
+        if (sampleFilter) sample = sampleFilter(slot, sample);
+        sample = (sample < 0) ? 0 : (sample > ADC_MAX) ? ADC_MAX : sample;
+    }
+
+    if (slot == 0) {
+        reading = sample;
+        if (window.getLength()) window.push(sample);
+        int16_t decimated;
+        if (decimating && decimator.push(sample, decimated)) decimatedBuffer.push(decimated);
+    }
+
+    // Calculate envelope value here //
+
+    int& envelope = envelopeValue[slot];
+
+    switch (envelopeEngine) {
+        case PEAK_HOLD_ENVELOPE:
+            envelope = peakHold(sample, envelopeAcc[slot], envelopeShift);
+            break;
+        case LOWPASS_ENVELOPE:
+            envelope = rectifyLowpass(sample, envelopeZero, envelopeAcc[slot], envelopeShift);
+            break;
+        case RMS_ENVELOPE:
+            // The square root is spread out, each slot takes it on a different tick //
+            meanSquare(sample, envelopeZero, envelopeAcc[slot], envelopeShift);
+            if (((uint8_t)stats.sequence & (RMS_UPDATE_INTERVAL - 1)) == slot) {
+                envelope = isqrt32(envelopeAcc[slot]) >> 4;
+            }
+            break;
+        default:
+            envelope = peakDecay(sample, envelope, NeuroBoard::decayRate);
+            break;
+    }
+
+    // Place new reading in buffer //
+
+    if (!buffer[slot].push(sample)) stats.overruns++;
+    stats.samplesProduced++;
+
+    // Queue the reading for the serial port. A frame is only started if all of it fits //
+
+#if TX_BUFFER_SIZE > 0
+    if (streamingMode == ISR_STREAMING) {
+
+        if (slot == 0) {
+            frameQueued = (uint8_t)(txBuffer.capacity() - txBuffer.available()) >= scanCount * 2;
+            if (!frameQueued) streamStats.framesDropped++;
+        }
+
+        if (frameQueued) {
+            txBuffer.push(encodeHigh(sample, slot == 0));
+            txBuffer.push(encodeLow(sample));
+        }
+
+    }
+#endif
+
+}
+
+#if TX_BUFFER_SIZE > 0
+
+
+/**
+ * Hands waiting bytes from txBuffer to Serial, without ever blocking. Runs in
+ * the sample ISR, either once a half packet is queued or once per millisecond.
+ * 
+ * At most one byte less than the free endpoint space is written. Filling the
+ * USB bank completely makes the CDC driver send a zero length packet, which
+ * may wait on the host; a partly filled bank is sent by the USB start of frame
+ * interrupt instead.
+**/
+inline void pumpSerial(void) {
+
+    uint8_t queued = txBuffer.available();
+    if (queued > streamStats.maxQueued) streamStats.maxQueued = queued;
+
+    if (queued < STREAM_CHUNK_SIZE / 2 && ++ticksSincePump < pumpInterval) return;
+    ticksSincePump = 0;
+    if (!queued) return;
+
+    int room = Serial.availableForWrite() - 1;
+    if (room <= 0) {
+        streamStats.stalls++;
+        return;
+    }
+
+    uint8_t chunk[STREAM_CHUNK_SIZE];
+    uint8_t length = txBuffer.read(chunk, (room < STREAM_CHUNK_SIZE) ? room : STREAM_CHUNK_SIZE);
+
+    Serial.write(chunk, length);
+    streamStats.bytesSent += length;
+
+}
+
+#endif
+
+/**
+ * Input pin of each button, active high. RED_BTN is on PD4, WHITE_BTN on PE6 (INT6).
+**/
+struct ButtonPin {
+    volatile uint8_t* port;
+    uint8_t bit;
+};
+
+const ButtonPin buttonPins[BUTTON_COUNT] = {{&PIND, B00010000}, {&PINE, B01000000}};
+
+inline bool buttonPressed(const uint8_t& index) {
+    return *buttonPins[index].port & buttonPins[index].bit;
+}
+
+/**
+ * Returns the index of RED_BTN or WHITE_BTN in the button arrays, or -1.
+**/
+int8_t buttonIndex(const uint8_t& button) {
+
+    return (button == RED_BTN) ? 0 : (button == WHITE_BTN) ? 1 : -1;
+
+}
+
+/**
+ * Queues the button's new state, unless it is still bouncing from its last edge.
+ * Only called from interrupts, which don't nest, so the queue has one producer
+ * at a time.
+**/
+inline void checkButton(const uint8_t& index, const ulong& now) {
+
+    if (now - buttonEdgeTime[index] < BUTTON_DEBOUNCE_MS) return;
+
+    bool pressed = buttonPressed(index);
+    if (pressed == buttonReported[index]) return;
+
+    ButtonEvent event;
+    event.button = index;
+    event.pressed = pressed;
+    event.time = now;
+
+    if (buttonQueue.push(event)) {
+        buttonReported[index] = pressed;
+        buttonEdgeTime[index] = now;
+    }
+
+}
+
+/**
+ * INT6 handler, timestamps WHITE_BTN edges as they happen.
+**/
+void whiteButtonEdge(void) {
+
+    checkButton(1, millis());
+
+}
+
+/**
+ * Runs every tick. RED_BTN has no pin interrupt, so it is sampled here. WHITE_BTN
+ * is checked too, to pick up its final state when the last edge was bounce.
+**/
+inline void pollButtons(void) {
+
+    ulong now = millis();
+    for (uint8_t index = 0; index < BUTTON_COUNT; index++) {
+        checkButton(index, now);
+    }
+
+}
+
+/**
+ * Starts the relay pulse train, the pin goes up on the next call to stepRelay.
+ * Call with interrupts off.
+**/
+inline void startRelay(void) {
+
+    relayPulsesLeft = relayCount;
+    relayTicksLeft = 1;
+    relayOn = false;
+    relayRunning = true;
+
+}
+
+/**
+ * Counts one sample tick of the relay pulse train and moves the pin when its time is up.
+**/
+inline void stepRelay(void) {
+
+    if (--relayTicksLeft) return;
+
+    if (!relayOn) {
+        PORTD = PORTD | BITMASK_ONE;   // digitalWrite(RELAY_PIN, ON);
+        relayOn = true;
+        relayTicksLeft = relayWidthTicks;
+        return;
+    }
+
+    PORTD = PORTD & I_BITMASK_ONE;     // digitalWrite(RELAY_PIN, OFF);
+    relayOn = false;
+    relayTicksLeft = relayIntervalTicks;
+
+    if (relayPulsesLeft && --relayPulsesLeft == 0) relayRunning = false;
+
+}
+
+/**
+ * Checks every trigger against the envelope values of the tick that just ended,
+ * and queues an event for each one that fired. handleInputs calls the callbacks.
+**/
+inline void checkTriggers(void) {
+
+    for (uint8_t i = 0; i < triggerCount; i++) {
+
+        Trigger& trigger = triggers[i];
+        if (!trigger.enabled || trigger.slot < 0) continue;
+
+        int level = envelopeValue[trigger.slot];
+        bool crossed = (trigger.edge == RISING_EDGE) ? (level >= trigger.threshold) : (level <= trigger.threshold);
+        bool rearmed = (trigger.edge == RISING_EDGE) ? (level <= trigger.secondThreshold) : (level >= trigger.secondThreshold);
+
+        if (crossed) {
+            if (!trigger.thresholdMet) {
+                trigger.thresholdMet = true;
+                TriggerEvent event;
+                event.trigger = i;
+                event.level = level;
+                event.sequence = stats.sequence;
+                event.micros = micros();
+                event.generation = trigger.generation;
+                if (!triggerQueue.push(event)) stats.eventsDropped++;
+                if (trigger.relay && !relayRunning) startRelay();
+            }
+        } else if (rearmed) {
+            trigger.thresholdMet = false;
+        }
+
+    }
+
+}
+
+// Servo and LED bar mappings, constrained to the selected sensitivity //
+
+#if SERVO_MAPPING == TABLE_MAPPING
+
+inline uint8_t lookupReading(const SensitivityTables& tables, const int& fromLow, const int& reading) {
+    const MapTable<MAP_TABLE_SIZE>& table = tables.levels[mapLevel];
+    uint8_t index = (constrain(reading, fromLow, servo.emgSaturationValue) - fromLow) >> pgm_read_byte(&table.shift);
+    return pgm_read_byte(&table.values[index]);
+}
+
+inline int openAngle(const int& reading) { return lookupReading(openTables, 40, reading); }
+inline int closedAngle(const int& reading) { return lookupReading(closedTables, 120, reading); }
+inline byte ledbarHeight(const int& reading) { return lookupReading(ledbarTables, 30, reading); }
+
+#else
+
+inline int openAngle(const int& reading) { return openMap.map(constrain(reading, 40, servo.emgSaturationValue)); }
+inline int closedAngle(const int& reading) { return closedMap.map(constrain(reading, 120, servo.emgSaturationValue)); }
+inline byte ledbarHeight(const int& reading) { return ledbarMap.map(constrain(reading, 30, servo.emgSaturationValue)); }
+
+#endif
+
+/**
+ * Moves the servo one frame towards the angle its input asks for, within the
+ * dead zone and slew limit. Runs in the sample interrupt once per servo frame.
+**/
+inline void stepServo(void) {
+
+    servo.ticksLeft = servoFrameTicks;
+
+    int input = (servoInput == SERVO_ENVELOPE_INPUT) ? envelopeValue[0] : reading;
+    int target = (servo.currentFunctionality == OPEN_MODE) ? openAngle(input) : closedAngle(input);
+    int16_t pulse = angleToPulse.map(constrain(target, 0, 180));
+
+    if (abs(pulse - servo.goal) > servoDeadbandWidth) servo.goal = pulse;
+
+    int16_t step = servo.goal - servo.position;
+    if (servoSlewStep && step > (int16_t)servoSlewStep) step = servoSlewStep;
+    if (servoSlewStep && step < -(int16_t)servoSlewStep) step = -servoSlewStep;
+
+    if (step) {
+        servo.position += step;
+        servo.Gripper.writeMicroseconds(servo.position);
+    }
+
+    // TCNT3 counts from the compare match that started this tick, getServoStats turns it into microseconds //
+
+    uint16_t latency = TCNT3;
+    servoStats.frames++;
+    servoStats.target = target;
+    servoStats.latency = latency;
+    if (latency > servoStats.maxLatency) servoStats.maxLatency = latency;
+
+}
+
+/**
+ * Does the per tick work, closes the tick's sample sequence number, then
+ * publishes the cycles spent on the tick. TCNT3 is read last so the work
+ * done here is counted too.
+ *
+ * @param spent Cycles spent on this tick by earlier interrupts.
+ * @param start TCNT3 when the current interrupt started.
+**/
+inline void finishTick(const uint16_t spent, const uint16_t start) {
+
+    stats.sequence++;
+    if (triggerCount) checkTriggers();
+    if (relayRunning) stepRelay();
+    if (servoEnabled && --servo.ticksLeft == 0) stepServo();
+    if (buttonsStarted) pollButtons();
+
+#if TX_BUFFER_SIZE > 0
+    if (streamingMode == ISR_STREAMING) pumpSerial();
+#endif
+
+    uint16_t end = TCNT3;
+    uint16_t elapsed = (end >= start) ? (end - start) : (end + timerTop + 1 - start);
+    uint16_t cycles = spent + (elapsed << timerShift);
+
+    isrCycles = cycles;
+    if (cycles > stats.maxISRCycles) stats.maxISRCycles = cycles;
+    avgCyclesQ4 += cycles - (avgCyclesQ4 >> 4);
+
+}
+
+/**
+ * Whether the notch for mains can run at rate, see notchUsable.
+**/
+inline bool notchFits(const uint8_t mains, const float& rate) {
+    return notchUsable(mains, rate, NOTCH_BANDWIDTH);
+}
+
+/**
+ * Starts the NOTCH_AUTO measurement over NOTCH_CALIBRATION_MS worth of samples.
+ * Nothing is measured at rates that can't hold both notches. Call with interrupts off.
+**/
+void startMainsCalibration(const float& rate) {
+
+    mainsCalibrated = false;
+    mainsCalibrating = notchFits(50, rate) && notchFits(60, rate)
+                    && mainsDetector.start(rate, NOTCH_CALIBRATION_MS, reading);
+
+}
+
+/**
+ * Picks the mains frequency once the NOTCH_AUTO measurement is done. Callers
+ * check mainsCalibrated first, so the sample rate is only worked out once.
+**/
+void finishMainsCalibration(const float& rate) {
+
+    if (!mainsCalibrated) return;
+
+    uint8_t mains = mainsDetector.mains();
+
+    BiquadCoefficients coefficients = notchCoefficients(mains, rate, NOTCH_BANDWIDTH);
+
+    noInterrupts();
+    notchKernel = coefficients;
+    for (uint8_t slot = 0; slot < MAX_CHANNELS; slot++) {
+        notch[slot].clear();
+    }
+    mainsFrequency = mains;
+    mainsCalibrated = false;
+    interrupts();
+
+}
+
+/**
+ * Converts the servo frame, slew rate and dead zone into sample ticks and pulse
+ * widths for the passed timer settings. Call with interrupts off.
+**/
+void servoTiming(const uint16_t& prescaler, const uint16_t& top) {
+
+    float microsPerDegree = (MAX_PULSE_WIDTH - MIN_PULSE_WIDTH) / 180.0f;
+    uint16_t frame = sampleTicks(SERVO_FRAME_US, prescaler, top);
+    float frameSeconds = (float)frame * prescaler * (top + 1UL) / F_CPU;
+
+    servoFrameTicks = frame;
+    servoSlewStep = servoSlewRate ? constrain(servoSlewRate * microsPerDegree * frameSeconds + 0.5f, 1, 0x7FFF) : 0;
+    servoDeadbandWidth = servoDeadband * microsPerDegree + 0.5f;
+
+}
+
+// ISR //
+
+ISR (TIMER3_COMPA_vect) {
+
+    if (samplingMode == ASYNC_SAMPLING) {
+
+        // Only start the conversion of slot 0, ADC_vect collects the results //
+        // and steps through the remaining slots.                              //
+
+        scanIndex = 0;
+        ADCSRA |= _BV(ADSC);
+        timerCycles = TCNT3 << timerShift;
+        return;
+
+    }
+
+    // Get readings from analog, each waits for the whole conversion //
+
+    for (uint8_t slot = 0; slot < scanCount; slot++) {
+        storeSample(slot, analogRead(scanChannels[slot]));
+    }
+
+    // TCNT3 restarts from 0 on the compare match (CTC mode) //
+
+    finishTick(0, 0);
+
+}
+
+#if defined(NEUROBOARD_LED_SPI) && defined(NEUROBOARD_LED_SPI_INTERRUPT)
+
+/**
+ * Latches the byte the SPI just shifted out, then sends the one queued behind it.
+**/
+ISR (SPI_STC_vect) {
+
+    PORTB |= LED_SPI_LATCH_PIN;
+
+    if (ledQueued) {
+        ledQueued = false;
+        PORTB &= ~LED_SPI_LATCH_PIN;
+        SPDR = ledQueuedByte;
+        return;
+    }
+
+    ledTransferring = false;
+
+}
+
+#endif
+
+ISR (ADC_vect) {
+
+    uint16_t start = TCNT3;
+    uint8_t slot = scanIndex;
+
+    if (slot >= scanCount) return; // Conversion started before the channels were changed
+
+    storeSample(slot, ADC);
+
+    // Step ADMUX to the next slot. After the last slot, select slot 0 //
+    // so it has settled before the next timer tick.                   //
+
+    if (++slot < scanCount) {
+        selectADCInput(scanMux[slot]);
+        ADCSRA |= _BV(ADSC);
+    } else {
+        selectADCInput(scanMux[0]);
+    }
+    scanIndex = slot;
+
+    if (slot >= scanCount) {
+        finishTick(timerCycles, start);
+        return;
+    }
+
+    uint16_t end = TCNT3;
+    uint16_t elapsed = (end >= start) ? (end - start) : (end + timerTop + 1 - start);
+    timerCycles += elapsed << timerShift;
+
+}
+
+// PUBLIC METHODS //
+
+/**
+ * Storage for a plain NeuroBoard. Kept inside a function so sketches using
+ * BufferedNeuroBoard don't link it in.
+**/
+int16_t* defaultSampleStorage(void) {
+
+    static_assert((long)MAX_CHANNELS * BUFFER_SIZE * sizeof(int16_t) <= SAMPLE_RAM_BUDGET, "Default sample buffers exceed SAMPLE_RAM_BUDGET");
+
+    static int16_t storage[MAX_CHANNELS * BUFFER_SIZE];
+    return storage;
+
+}
+
+NeuroBoard::NeuroBoard(void) : NeuroBoard(defaultSampleStorage(), BUFFER_SIZE, MAX_CHANNELS) {}
+
+NeuroBoard::NeuroBoard(int16_t* storage, const uint8_t& depth, const uint8_t& channels) {
+
+    this->sampleStorage = storage;
+    this->bufferDepth = depth;
+    this->bufferChannels = channels;
+
+}
+
+void NeuroBoard::startMeasurements(void) {
+
+    // Start Serial //
+
+    Serial.begin(SERIAL_CAP);
+
+    // Set pin modes for Stanislav's code //
+
+    pinMode(14, OUTPUT); // MISO
+    pinMode(15, OUTPUT); // SCK
+    pinMode(16, OUTPUT); // MOSI
+
+    // Bind each channel's buffer to this board's storage. Done here rather than in the //
+    // constructor so it can't run before the buffers themselves are constructed.       //
+
+    for (uint8_t slot = 0; slot < this->bufferChannels; slot++) {
+        buffer[slot].attach(this->sampleStorage + slot * this->bufferDepth, this->bufferDepth);
+    }
+
+    // Prepare ADC multiplexer values for the scanned channels //
+
+    for (uint8_t slot = 0; slot < scanCount; slot++) {
+        scanMux[slot] = adcMux(scanChannels[slot]);
+    }
+
+    // Set relay pin //
+
+    pinMode(RELAY_PIN, OUTPUT);
+
+    // Initialize timer //
+
+    // Disable interrupts //
+
+    noInterrupts();
+
+    // Set prescale to 16 for analogRead
+
+    sbi(ADCSRA, ADPS2);
+    cbi(ADCSRA, ADPS1);
+    cbi(ADCSRA, ADPS0);
+
+    // Set timer register flags //
+
+    TCCR3A = 0;
+    TCCR3B = 0;
+    TCNT3 = 0;
+
+    // Configure timer registers //
+
+    // CTC mode, the compare match fires every (timerTop + 1) * timerPrescaler cycles //
+
+    OCR3A = timerTop;
+    TCCR3B = _BV(WGM32) | sampleRateClockSelect(timerPrescaler);
+    TIMSK3 |= _BV(OCIE3A);
+    timerStarted = true;
+
+    // Enable interrupts //
+
+    interrupts();
+
+}
+
+float NeuroBoard::setSampleRate(const ulong& hz) {
+
+    // Reject rates Timer3 can't reach or the ADC can't keep up with //
+
+    if (hz < MIN_SAMPLE_RATE || hz * scanCount > MAX_SAMPLE_RATE) return 0;
+
+    uint16_t prescaler = sampleRatePrescaler(hz);
+    uint16_t top = sampleRateTop(hz, prescaler);
+
+    if (!this->applySampleRate(prescaler, top)) return 0;
+
+    return sampleRateAchieved(prescaler, top);
+
+}
+
+bool NeuroBoard::applySampleRate(const uint16_t& prescaler, const uint16_t& top) {
+
+    // The notch moves with the sample rate, keep the current rate if it can't follow //
+
+    float rate = sampleRateAchieved(prescaler, top);
+    if (mainsFrequency && !notchFits(mainsFrequency, rate)) return false;
+    if ((mainsCalibrating || mainsCalibrated) && !(notchFits(50, rate) && notchFits(60, rate))) return false;
+
+    BiquadCoefficients coefficients = notchKernel;
+    if (mainsFrequency) coefficients = notchCoefficients(mainsFrequency, rate, NOTCH_BANDWIDTH);
+
+    noInterrupts();
+
+    if (mainsFrequency) notchKernel = coefficients;
+    if (mainsCalibrating || mainsCalibrated) startMainsCalibration(rate);
+
+    timerPrescaler = prescaler;
+    timerTop = top;
+
+    timerShift = 0;
+    for (uint16_t p = prescaler; p > 1; p >>= 1) {
+        timerShift++;
+    }
+
+    // Servo latencies are kept in timer ticks, those of the old prescaler don't convert //
+
+    servoStats.latency = 0;
+    servoStats.maxLatency = 0;
+
+    envelopeShift = timeConstantShiftMs(envelopeMs, rate);
+    relayWidthTicks = sampleTicks(relayWidthUs, prescaler, top);
+    relayIntervalTicks = sampleTicks(relayIntervalUs, prescaler, top);
+    servoTiming(prescaler, top);
+
+    // Reprogram the timer if it's already running, otherwise startMeasurements will //
+
+    if (timerStarted) {
+        TCCR3B = 0;
+        OCR3A = timerTop;
+        TCNT3 = 0;
+        TCCR3B = _BV(WGM32) | sampleRateClockSelect(timerPrescaler);
+    }
+
+    interrupts();
+
+    return true;
+
+}
+
+float NeuroBoard::getSampleRate(void) {
+
+    return sampleRateAchieved(timerPrescaler, timerTop);
+
+}
+
+void NeuroBoard::setSamplingMode(const int& mode) {
+
+    noInterrupts();
+
+    samplingMode = mode;
+
+    if (mode == ASYNC_SAMPLING) {
+        selectADCInput(scanMux[0]);
+        sbi(ADCSRA, ADIF); // Clear any stale conversion flag
+        sbi(ADCSRA, ADIE);
+    } else {
+        cbi(ADCSRA, ADIE); // analogRead() polls ADSC itself
+    }
+
+    isrCycles = 0;
+
+    interrupts();
+
+}
+
+uint16_t NeuroBoard::getISRCycles(void) {
+
+    noInterrupts();
+    uint16_t cycles = isrCycles;
+    interrupts();
+
+    return cycles;
+
+}
+
+AcquisitionStats NeuroBoard::getStats(void) {
+
+    noInterrupts();
+    AcquisitionStats copy = stats;
+    copy.avgISRCycles = avgCyclesQ4 >> 4;
+    interrupts();
+
+    return copy;
+
+}
+
+void NeuroBoard::resetStats(void) {
+
+    noInterrupts();
+    ulong sequence = stats.sequence; // The sequence number never goes backwards
+    stats = AcquisitionStats();
+    stats.sequence = sequence;
+    avgCyclesQ4 = 0;
+    interrupts();
+
+}
+
+/**
+ * Sends as many whole frames as the serial port can take without blocking.
+ * Each sample is two bytes holding 7 bits each, and the first byte of every
+ * frame has its top bit set so the host can find frame boundaries. Channels
+ * follow each other in scan order within a frame.
+**/
+void streamFrames(void) {
+
+    int room = Serial.availableForWrite();
+    if (room > STREAM_CHUNK_SIZE) room = STREAM_CHUNK_SIZE;
+
+    // Only send frames every scanned channel has a sample for //
+
+    uint8_t frames = room / (scanCount * 2);
+    for (uint8_t slot = 0; slot < scanCount; slot++) {
+        uint8_t waiting = buffer[slot].available();
+        if (waiting < frames) frames = waiting;
+    }
+    if (!frames) return;
+
+    uint8_t chunk[STREAM_CHUNK_SIZE];
+    uint8_t length = 0;
+
+    for (uint8_t frame = 0; frame < frames; frame++) {
+        for (uint8_t slot = 0; slot < scanCount; slot++) {
+            int16_t sample = 0;
+            buffer[slot].pop(sample);
+            chunk[length++] = encodeHigh(sample, slot == 0);
+            chunk[length++] = encodeLow(sample);
+        }
+    }
+
+    Serial.write(chunk, length);
+    streamStats.bytesSent += length;
+    stats.samplesConsumed += frames * scanCount;
+
+}
+
+void NeuroBoard::startStreaming(const int& mode) {
+
+#if TX_BUFFER_SIZE > 0
+
+    noInterrupts();
+
+    // Flush at least once per millisecond when the queue fills slowly //
+
+    float ticksPerMs = this->getSampleRate() / 1000;
+    pumpInterval = (ticksPerMs < 1) ? 1 : (ticksPerMs > 255) ? 255 : (uint8_t)ticksPerMs;
+    ticksSincePump = 0;
+    frameQueued = false;
+    txBuffer.clear();
+    streamingMode = mode;
+
+    interrupts();
+
+#else
+
+    // Without a TX buffer the samples go out from handleInputs //
+
+    (void)mode;
+    streamingMode = LOOP_STREAMING;
+
+#endif
+
+}
+
+void NeuroBoard::stopStreaming(void) {
+
+    streamingMode = 0;
+
+}
+
+StreamStats NeuroBoard::getStreamStats(void) {
+
+    noInterrupts();
+    StreamStats copy = streamStats;
+#if TX_BUFFER_SIZE > 0
+    copy.queued = txBuffer.available();
+#endif
+    interrupts();
+
+    return copy;
+
+}
+
+/**
+ * Calls the gesture's callback.
+**/
+inline void fireGesture(Gesture& gesture) {
+
+    gesture.fired = true;
+    gesture.callback();
+
+}
+
+/**
+ * Marks the current press of every button in mask as used, so releasing
+ * them isn't also counted as a press.
+**/
+void consumeButtons(const uint8_t& mask) {
+
+    for (uint8_t index = 0; index < BUTTON_COUNT; index++) {
+        if (mask & (1 << index)) {
+            buttonState[index].consumed = true;
+            buttonState[index].presses = 0;
+        }
+    }
+
+}
+
+/**
+ * Calls the press or multi press gesture matching the presses counted on a button.
+**/
+void countPresses(const uint8_t& index) {
+
+    uint8_t presses = buttonState[index].presses;
+    buttonState[index].presses = 0;
+
+    for (uint8_t i = 0; i < gestureCount; i++) {
+        Gesture& gesture = gestures[i];
+        if (!gesture.enabled || gesture.buttons != (1 << index)) continue;
+        if ((gesture.type == PRESS_GESTURE && presses == 1) ||
+            (gesture.type == MULTI_PRESS_GESTURE && presses == gesture.value)) {
+            fireGesture(gesture);
+        }
+    }
+
+}
+
+/**
+ * Returns when every button of the gesture was down, the latest of their presses.
+**/
+ulong gestureStart(const Gesture& gesture) {
+
+    ulong start = 0;
+    bool first = true;
+
+    for (uint8_t index = 0; index < BUTTON_COUNT; index++) {
+        if (!(gesture.buttons & (1 << index))) continue;
+        ulong downTime = buttonState[index].downTime;
+        if (first || (long)(downTime - start) > 0) start = downTime;
+        first = false;
+    }
+
+    return start;
+
+}
+
+/**
+ * Turns queued button edges into gestures, then times holds, repeats and
+ * multi press gaps that are still open. Each call handles at most the queued
+ * edges times the gesture table, so it runs in bounded time.
+ * 
+ * A hold repeat fires on the press and takes over its buttons: press, multi
+ * press and long press gestures of the same buttons don't fire for that press.
+**/
+void handleButtons(void) {
+
+    ButtonEvent event;
+    while (buttonQueue.pop(event)) {
+
+        uint8_t bit = 1 << event.button;
+        ButtonState& state = buttonState[event.button];
+
+        if (event.pressed) {
+
+            state.down = true;
+            state.downTime = event.time;
+            state.consumed = false;
+            buttonsDown |= bit;
+
+            // Chords and hold repeats start as soon as all their buttons are down //
+
+            uint8_t repeating = 0;
+
+            for (uint8_t i = 0; i < gestureCount; i++) {
+                Gesture& gesture = gestures[i];
+                if (!gesture.enabled || !(gesture.buttons & bit) || (buttonsDown & gesture.buttons) != gesture.buttons) continue;
+                gesture.fired = false;
+                if (gesture.type == HOLD_REPEAT_GESTURE || (gesture.type == PRESS_GESTURE && gesture.buttons != bit)) {
+                    consumeButtons(gesture.buttons);
+                    fireGesture(gesture);
+                    gesture.next = event.time + HOLD_REPEAT_DELAY_MS;
+                    if (gesture.type == HOLD_REPEAT_GESTURE) repeating |= gesture.buttons;
+                }
+            }
+
+            // Long presses of repeating buttons count as already fired //
+
+            for (uint8_t i = 0; repeating && i < gestureCount; i++) {
+                Gesture& gesture = gestures[i];
+                if (gesture.type == LONG_PRESS_GESTURE && (gesture.buttons & repeating) == gesture.buttons) gesture.fired = true;
+            }
+
+            continue;
+
+        }
+
+        // A hold that ended before loop() got to time it still counts //
+
+        for (uint8_t i = 0; i < gestureCount; i++) {
+            Gesture& gesture = gestures[i];
+            if (!gesture.enabled || gesture.type != LONG_PRESS_GESTURE || gesture.fired) continue;
+            if (!(gesture.buttons & bit) || (buttonsDown & gesture.buttons) != gesture.buttons) continue;
+            if (event.time - gestureStart(gesture) >= gesture.value) {
+                consumeButtons(gesture.buttons);
+                fireGesture(gesture);
+            }
+        }
+
+        state.down = false;
+        state.upTime = event.time;
+        buttonsDown &= ~bit;
+
+        if (state.consumed) continue;
+
+        // Too long for a press. Presses counted before it are reported on their own //
+
+        if (event.time - state.downTime > SHORT_PRESS_MS) {
+            if (state.presses) countPresses(event.button);
+            continue;
+        }
+
+        // Without multi press gestures to wait for, a press is reported right away //
+
+        if (++state.presses >= state.maxPresses) countPresses(event.button);
+
+    }
+
+    ulong now = millis();
+    buttonTimersPending = false;
+
+    for (uint8_t i = 0; i < gestureCount; i++) {
+
+        Gesture& gesture = gestures[i];
+        if (!gesture.enabled || (buttonsDown & gesture.buttons) != gesture.buttons) continue;
+
+        if (gesture.type == LONG_PRESS_GESTURE && !gesture.fired) {
+            if (now - gestureStart(gesture) >= gesture.value) {
+                consumeButtons(gesture.buttons);
+                fireGesture(gesture);
+            } else {
+                buttonTimersPending = true;
+            }
+        }
+
+        if (gesture.type == HOLD_REPEAT_GESTURE) {
+            if ((long)(now - gesture.next) >= 0) {
+                fireGesture(gesture);
+                gesture.next += gesture.value;
+            }
+            buttonTimersPending = true;
+        }
+
+    }
+
+    for (uint8_t index = 0; index < BUTTON_COUNT; index++) {
+
+        ButtonState& state = buttonState[index];
+        if (!state.presses) continue;
+
+        if (!state.down && now - state.upTime > DOUBLE_PRESS_MS) {
+            countPresses(index);
+        } else {
+            buttonTimersPending = true;
+        }
+
+    }
+
+}
+
+void NeuroBoard::handleInputs(void) {
+
+    // Send waiting samples to the host //
+
+    if (streamingMode == LOOP_STREAMING) {
+        streamFrames();
+    }
+
+    // Pick the mains frequency once NOTCH_AUTO has measured it //
+
+    if (mainsCalibrated) {
+        finishMainsCalibration(this->getSampleRate());
+    }
+
+    // Run the button state machine on new edges, or while a hold or double press is being timed //
+
+    if (!buttonQueue.empty() || buttonTimersPending) {
+        handleButtons();
+    }
+
+    // Call back triggers the sample interrupt saw fire, oldest first //
+
+    TriggerEvent event;
+    while (triggerQueue.pop(event)) {
+
+        Trigger& trigger = triggers[event.trigger];
+        if (!trigger.enabled || trigger.generation != event.generation) continue; // Removed after it fired
+
+        lastTriggerEvent = event;
+        if (trigger.callback) trigger.callback(); // The sample interrupt already started the relay
+
+    }
+
+    // EMG Strength Code //
+
+    if (emgStrengthEnabled) {
+
+        // Calculate what LEDs should be turned ON on the LED bar
+        servo.ledbarHeight = ledbarHeight(reading);
+
+        // Display fix for when servo is disabled, but user still wants visual feedback
+        // Last check is for a Leonardo Board. Not tested with an Arduino Uno yet.
+        if (!servoEnabled and servo.ledbarHeight == 7 and MAX_LEDS == 8) {
+            servo.ledbarHeight++;
+        }
+
+        // Show it, the bar is only shifted out when the height changed
+        this->writeLEDBar(servo.ledbarHeight);
+
+    }
+
+}
+
 /**
- * Faster version of map() that doesn't use multiplication or division.
+ * Loads the selected sensitivity and works out the mappings that depend on it,
+ * so handleInputs maps readings without dividing. The tables of TABLE_MAPPING
+ * only need the level.
 **/
-long fasterMap(long value, long fromLow, long fromHigh, long toLow, long toHigh) {
+void selectSensitivity(void) {
+
+    int saturation = servo.sensitivities[servo.lastSensitivitiesIndex];
+
+    noInterrupts();
+
+    servo.emgSaturationValue = saturation;
+
+#if SERVO_MAPPING == TABLE_MAPPING
+    mapLevel = servo.lastSensitivitiesIndex;
+#else
+    openMap.set(40, saturation, 190, 105);
+    closedMap.set(120, saturation, 105, 190);
+    ledbarMap.set(30, saturation, 0, MAX_LEDS);
+#endif
+
+    interrupts();
+
+}
+
+void NeuroBoard::startServo(void) {
+
+    // Ensure servo isn't already enabled before starting
+    if (servoEnabled) return;
+
+    // Attach servo to board
+    servo.Gripper.attach(SERVO_PIN);
+
+    PORTD = PORTD & I_BITMASK_ONE; // digitalWrite(RELAY_PIN, OFF);
+
+    // Initialize all LED pins to output
+    for (int i = 0; i < MAX_LEDS; i++) {
+        pinMode(this->ledPins[i], OUTPUT);
+    }
+
+    // Get current sensitivity
+    selectSensitivity();
 
-    long first = value - fromLow;
-    long second = toHigh - toLow;
-    long combined = 0;
-    while (second > 0) {                   // Avoid usage of * operator
-        combined = combined + first;
-        second = second - 1;
+    // The sample interrupt takes over from here, the first frame is on the next tick //
+
+    noInterrupts();
+    servoTiming(timerPrescaler, timerTop);
+    servo.ticksLeft = 1;
+    servoStats = ServoStats();
+    servoEnabled = true;
+    interrupts();
+
+}
+
+void NeuroBoard::endServo(void) {
+
+    // Ensure servo is enabled before disabling
+    if (!servoEnabled) return;
+
+    // Set servo boolean value to false
+    servoEnabled = false;
+
+    // Detach servo
+    servo.Gripper.detach();
+
+    // Reset servo object to default values
+    servo = NeuroServo();
+
+}
+
+void NeuroBoard::increaseSensitivity(void) {
+
+    // Ensure servo is enabled before modifying sensitivity value
+    if (!servoEnabled || servo.lastSensitivitiesIndex == SENSITIVITY_LEVELS - 1) return; // End of sensitivity array
+
+    // Increment sensitivity index
+    servo.lastSensitivitiesIndex++;
+
+    // Get current sensitivity value
+    selectSensitivity();
+
+}
+
+void NeuroBoard::decreaseSensitivity(void) {
+
+    // Ensure servo is enabled before modifying sensitivity value
+    if (!servoEnabled || servo.lastSensitivitiesIndex == 0) return;
+
+    // Decrement sensitivity index
+    servo.lastSensitivitiesIndex--;
+
+    // Get current sensitivity value
+    selectSensitivity();
+
+}
+
+void NeuroBoard::setServoDefaultPosition(const int& position) {
+
+    servo.currentFunctionality = position;
+
+}
+
+void NeuroBoard::setServoSlewRate(const uint16_t& degreesPerSecond) {
+
+    noInterrupts();
+    servoSlewRate = degreesPerSecond;
+    servoTiming(timerPrescaler, timerTop);
+    interrupts();
+
+}
+
+void NeuroBoard::setServoDeadband(const uint8_t& degrees) {
+
+    noInterrupts();
+    servoDeadband = degrees;
+    servoTiming(timerPrescaler, timerTop);
+    interrupts();
+
+}
+
+void NeuroBoard::setServoInput(const uint8_t& input) {
+
+    servoInput = input;
+
+}
+
+ServoStats NeuroBoard::getServoStats(void) {
+
+    noInterrupts();
+    ServoStats copy = servoStats;
+    int16_t position = servo.position;
+    uint8_t shift = timerShift;
+    interrupts();
+
+    copy.angle = map(position, MIN_PULSE_WIDTH, MAX_PULSE_WIDTH, 0, 180);
+    copy.latency = ((ulong)copy.latency << shift) / (F_CPU / 1000000UL);
+    copy.maxLatency = ((ulong)copy.maxLatency << shift) / (F_CPU / 1000000UL);
+    return copy;
+
+}
+
+int NeuroBoard::getNewSample(void) {
+
+    return this->getNewSample(scanChannels[0]);
+
+}
+
+int NeuroBoard::getNewSample(const uint8_t& channel) {
+
+    int8_t slot = channelSlot(channel);
+    if (slot < 0) return 0;
+
+    // If nothing new has arrived, hand back the last measured sample again //
+
+    int16_t value;
+    if (buffer[slot].pop(value)) {
+        stats.samplesConsumed++;
+    } else {
+        value = buffer[slot].last();
+        stats.underruns++;
+    }
+
+    return value;
+
+}
+
+size_t NeuroBoard::readSamples(int16_t* dst, const size_t& max, uint16_t* lost) {
+
+    return this->readSamples(scanChannels[0], dst, max, lost);
+
+}
+
+size_t NeuroBoard::readSamples(const uint8_t& channel, int16_t* dst, const size_t& max, uint16_t* lost) {
+
+    int8_t slot = channelSlot(channel);
+    if (slot < 0) return 0;
+
+    if (lost) *lost = buffer[slot].takeOverruns();
+
+    // The buffer never holds more than bufferDepth samples, so one read empties it //
+
+    uint8_t count = buffer[slot].read(dst, (max < this->bufferDepth) ? max : this->bufferDepth);
+    stats.samplesConsumed += count;
+
+    return count;
+
+}
+
+uint8_t NeuroBoard::peekSamples(SampleSpan spans[2]) {
+
+    return this->peekSamples(scanChannels[0], spans);
+
+}
+
+uint8_t NeuroBoard::peekSamples(const uint8_t& channel, SampleSpan spans[2]) {
+
+    int8_t slot = channelSlot(channel);
+    if (slot < 0) {
+        spans[0].length = 0;
+        spans[1].length = 0;
+        return 0;
     }
-    long third = fromHigh - fromLow;
-    long count = 0;
-    while (combined >= third) {            // Avoid usage of / operator
-        combined = combined - third;
-        count = count + 1;
+
+    return buffer[slot].peek(spans);
+
+}
+
+uint8_t NeuroBoard::commitSamples(const uint8_t& count) {
+
+    return this->commitSamples(scanChannels[0], count);
+
+}
+
+uint8_t NeuroBoard::commitSamples(const uint8_t& channel, const uint8_t& count) {
+
+    int8_t slot = channelSlot(channel);
+    if (slot < 0) return 0;
+
+    stats.samplesConsumed += count;
+
+    return buffer[slot].commit(count);
+
+}
+
+void NeuroBoard::getSamples(int* arr[], const int& size) {
+
+    *arr = new int[size];
+    for (int i = 0; i < size; i++) {
+        // We can't just access the buffer directly because we need to modify it once retrieving a value.
+        (*arr)[i] = this->getNewSample();
     }
-    count = count + toLow;
-    return count;
 
 }
 
-// Button Wait Variables //
+int NeuroBoard::getEnvelopeValue(void) {
 
-ulong redCount = 0;
-ulong whiteCount = 0;
-ulong redDebounceCount = 0;
-ulong whiteDebounceCount = 0;
+    return envelopeValue[0];
 
-// Button Variables //
+}
 
-Button redButtonTrigger = Button();
-Button whiteButtonTrigger = Button();
-Button redLongButtonTrigger = Button();
-Button whiteLongButtonTrigger = Button();
+int NeuroBoard::getEnvelopeValue(const uint8_t& channel) {
 
-// Trigger Variable //
+    int8_t slot = channelSlot(channel);
+    if (slot < 0) return 0;
 
-Trigger envelopeTrigger = Trigger();
+    noInterrupts();
+    int value = envelopeValue[slot];
+    interrupts();
 
-// Servo Variable //
+    return value;
 
-NeuroServo servo = NeuroServo();
-bool servoEnabled = false;
-bool emgStrengthEnabled = false;
+}
 
-int NeuroBoard::decayRate = 1;
+bool NeuroBoard::setNotchFilter(const int& mains) {
 
-// Buffer Variables //
+    float rate = this->getSampleRate();
 
-int* buffer = new int[BUFFER_SIZE];
-int head = 0;
-int tail = 0;
-bool full = false;
+    if (mains == 50 || mains == 60) {
+        if (!notchFits(mains, rate)) return false;
+        this->applyNotchFilter(mains, notchCoefficients(mains, rate, NOTCH_BANDWIDTH));
+        return true;
+    }
 
-// Envelope Value //
+    // NOTCH_AUTO measures the unfiltered signal, NOTCH_OFF stops here //
 
-int envelopeValue;
+    noInterrupts();
+    mainsFrequency = 0;
+    mainsCalibrating = false;
+    mainsCalibrated = false;
+    if (mains == NOTCH_AUTO) startMainsCalibration(rate);
+    interrupts();
 
-// Serial variable, changed in startCommunication method //
+    return mains != NOTCH_AUTO || mainsCalibrating;
 
-bool communicate = false;
-uint8_t NeuroBoard::channel = A0;
+}
 
-// Variables for button holding //
+void NeuroBoard::applyNotchFilter(const uint8_t& mains, const BiquadCoefficients& coefficients) {
 
-int RBD = 0;                // Red Button Down
-ulong RBT = 0;              // Red Button Time
-int RBC = 0;                // Red Button Collected
+    noInterrupts();
 
-int WBD = 0;                // White Button Down
-ulong WBT = 0;              // White Button Time
-int WBC = 0;                // White Button Collected
+    notchKernel = coefficients;
+    for (uint8_t slot = 0; slot < MAX_CHANNELS; slot++) {
+        notch[slot].clear();
+    }
+    mainsFrequency = mains;
+    mainsCalibrating = false;
+    mainsCalibrated = false;
 
-int redLongButtonHeld = 0;
-int whiteLongButtonHeld = 0;
+    interrupts();
 
-int redLongCalled = 0;
-int whiteLongCalled = 0;
+}
 
-// Sample variable //
+int NeuroBoard::getMainsFrequency(void) {
 
-int reading;
+    if (mainsCalibrated) {
+        finishMainsCalibration(this->getSampleRate());
+    }
 
-// ISR //
+    return mainsFrequency;
 
-ISR (TIMER3_COMPA_vect) {
+}
 
-    // Get reading from analog //
+void NeuroBoard::setSampleFilter(int16_t (*filter)(uint8_t slot, int16_t sample)) {
 
-    reading = analogRead(NeuroBoard::channel);
+    noInterrupts();
+    sampleFilter = filter;
+    interrupts();
 
-    // Calculate envelope value here //
+}
 
-    envelopeValue = (reading >= envelopeValue) ? (reading) : (envelopeValue - NeuroBoard::decayRate);
+bool NeuroBoard::setDecimation(const uint8_t& factor) {
 
-    // Place new reading in buffer //
+    if (factor > MAX_DECIMATION || (factor & (factor - 1))) return false;
 
-    buffer[head] = reading;
+    noInterrupts();
+    decimating = factor;
+    if (factor) decimator.setFactor(factor);
+    decimatedBuffer.clear();
+    interrupts();
 
-    if (full) {
-        tail = (tail == BUFFER_SIZE) ? (0) : (tail + 1);
-    }
-    head = (head == BUFFER_SIZE) ? (0) : (head + 1);
-    full = head == tail;
+    return true;
 
 }
 
-// PUBLIC METHODS //
+int NeuroBoard::getNewDecimatedSample(void) {
 
-void NeuroBoard::startMeasurements(void) {
+    int16_t value;
+    if (!decimatedBuffer.pop(value)) value = decimatedBuffer.last();
 
-    // Start Serial //
+    return value;
 
-    Serial.begin(SERIAL_CAP);
+}
 
-    // Set pin modes for Stanislav's code //
+float NeuroBoard::getDecimatedRate(void) {
 
-    pinMode(14, OUTPUT); // MISO
-    pinMode(15, OUTPUT); // SCK
-    pinMode(16, OUTPUT); // MOSI
+    if (!decimating) return 0;
 
-    // Set relay pin //
+    return this->getSampleRate() / decimator.getFactor();
 
-    pinMode(RELAY_PIN, OUTPUT);
+}
 
-    // Initialize timer //
+bool NeuroBoard::setWindowSize(const uint8_t& samples) {
 
-    // Disable interrupts //
+    if (samples > WINDOW_MAX_SIZE) return false;
 
     noInterrupts();
+    window.setLength(samples);
+    interrupts();
 
-    // Set prescale to 16 for analogRead
-
-    sbi(ADCSRA, ADPS2);
-    cbi(ADCSRA, ADPS1);
-    cbi(ADCSRA, ADPS0);
+    return true;
 
-    // Set timer register flags //
+}
 
-    TCCR3A = 0;
-    TCCR3B = 0;
-    TCNT3 = 0;
+int NeuroBoard::getWindowMean(void) {
 
-    // Configure timer registers //
+    noInterrupts();
+    int32_t sum = window.getSum();
+    uint8_t count = window.getCount();
+    interrupts();
 
-    // Performance Upgrade //
-    // 35 samples/second => 245 samples/second
+    return count ? (sum / count) : 0;
 
-    OCR3A = 31250;
-    TCCR3B = (TCCR3B & 0xF8) | 0x01;
-    TIMSK3 |= (1 << OCIE1A);
+}
 
-    // Enable interrupts //
+int NeuroBoard::getWindowRMS(void) {
 
+    noInterrupts();
+    uint32_t sumSquares = window.getSumSquares();
+    uint8_t count = window.getCount();
     interrupts();
 
+    return count ? isqrt32(sumSquares / count) : 0;
+
 }
 
-bool redPressed() { return PIND & B00010000; }
-bool whitePressed() { return PINE & B01000000; }
+bool NeuroBoard::getWindowMinMax(int& min, int& max) {
 
-void NeuroBoard::handleInputs(void) {
+    noInterrupts();
+    bool filled = window.getCount();
+    if (filled) {
+        min = window.getMin();
+        max = window.getMax();
+    }
+    interrupts();
 
-    // Check if buttons are enabled //
+    return filled;
 
-    if (redButtonTrigger.enabled) {
-        if (redPressed()) {
-            RBD = 1;
-            if (!RBC) {
-                RBT = millis();
-                RBC = 1;
-            }
-        } else {
-            if (RBD) {
-                if ((millis() - RBT) <= 250) {
-                    redButtonTrigger.callback();
-                }
-                RBD = 0;
-                RBC = 0;
-            }
-        }
-    }
+}
 
-    if (whiteButtonTrigger.enabled) {
-        if (whitePressed()) {
-            WBD = 1;
-            if (!WBC) {
-                WBT = millis();
-                WBC = 1;
-            }
-        } else {
-            if (WBD) {
-                if ((millis() - WBT) <= 250) {
-                    whiteButtonTrigger.callback();
-                }
-                WBD = 0;
-                WBC = 0;
-            }
-        }
-    }
+void NeuroBoard::setChannel(const uint8_t& newChannel) {
 
-    if (redLongButtonTrigger.enabled) {
-        if (redPressed()) {
-            if (redLongButtonHeld) {
-                if (wait(redLongButtonTrigger.interval, redCount)) {
-                    if (!redLongCalled) {
-                        redLongButtonTrigger.callback();
-                        redLongButtonHeld = 0;
-                        redLongCalled = 1;
-                    }
-                }
-            }
-            redLongButtonHeld = 1;
-        } else {
-            redLongButtonHeld = 0;
-            redLongCalled = 0;
-            redCount = millis();
-        }
-    }
+    this->setChannels(&newChannel, 1);
 
-    if (whiteLongButtonTrigger.enabled) {
-        if (whitePressed()) {
-            if (whiteLongButtonHeld) {
-                if (wait(whiteLongButtonTrigger.interval, whiteCount)) {
-                    if (!whiteLongCalled) {
-                        whiteLongButtonTrigger.callback();
-                        whiteLongButtonHeld = 0;
-                        whiteLongCalled = 1;
-                    }
-                }
-            }
-            whiteLongButtonHeld = 1;
-        } else {
-            whiteLongButtonHeld = 0;
-            whiteLongCalled = 0;
-            whiteCount = millis();
-        }
-    }
+}
 
-    // Check if envelope trigger is set //
+bool NeuroBoard::setChannels(const uint8_t channels[], const uint8_t& count) {
 
-    if (envelopeTrigger.enabled) {
+    // Every channel is converted once per tick, so the ADC must keep up with all of them //
 
-        if (envelopeValue >= envelopeTrigger.threshold) {
-            if (!envelopeTrigger.thresholdMet) {
-                envelopeTrigger.thresholdMet = true;
-                envelopeTrigger.callback();
-                PORTD = PORTD | BITMASK_ONE;   // digitalWrite(RELAY_PIN, ON);
-                delay(1);                      // Wait 1 ms to register relay pin as ON.
-                PORTD = PORTD & I_BITMASK_ONE; // digitalWrite(RELAY_PIN, OFF);
-            }
-        } else {
-            if (envelopeValue <= envelopeTrigger.secondThreshold) {
-                envelopeTrigger.thresholdMet = false;
-            }
-        }
+    if (count == 0 || count > this->bufferChannels) return false;
+    if (this->getSampleRate() * count > MAX_SAMPLE_RATE) return false;
+
+    noInterrupts();
 
+    for (uint8_t slot = 0; slot < count; slot++) {
+        scanChannels[slot] = (channels[slot] >= A0) ? (channels[slot]) : (channels[slot] + A0);
+        scanMux[slot] = adcMux(channels[slot]);
+        buffer[slot].clear();
+        envelopeValue[slot] = 0;
+        envelopeAcc[slot] = 0;
+        notch[slot].clear();
+    }
+    scanCount = count;
+    scanIndex = count;
+    for (uint8_t i = 0; i < triggerCount; i++) {
+        triggers[i].slot = triggerSlot(triggers[i].channel);
+    }
+    window.setLength(window.getLength()); // Restart the window and decimator on the new first channel
+    decimator.clear();
+    decimatedBuffer.clear();
+    NeuroBoard::channel = channels[0];
+
+    if (samplingMode == ASYNC_SAMPLING) {
+        selectADCInput(scanMux[0]);
+        sbi(ADCSRA, ADIF); // Drop a result from the old channels
     }
 
-    // Servo Code //
+    interrupts();
 
-    if (servoEnabled) {
+    return true;
 
-        servo.analogReadings = reading;
+}
 
-        // Set new angle if enough time passed
-        if (millis() - servo.oldTime > MINIMUM_SERVO_UPDATE_TIME) {
+uint8_t NeuroBoard::getBufferDepth(void) {
 
-            // Calculate new angle for servo
-            if (servo.currentFunctionality == OPEN_MODE) {
-                servo.analogReadings = constrain(servo.analogReadings, 40, servo.emgSaturationValue);
-                servo.newDegree = fasterMap(servo.analogReadings, 40, servo.emgSaturationValue, 190, 105);
-            } else {
-                servo.analogReadings = constrain(servo.analogReadings, 120, servo.emgSaturationValue);
-                servo.newDegree = fasterMap(servo.analogReadings, 120, servo.emgSaturationValue, 105, 190);
-            }
+    return this->bufferDepth;
 
-            // Check if we are in servo dead zone
-            if (abs(servo.newDegree - servo.oldDegrees) > GRIPPER_MINIMUM_STEP) {
-                // Set new servo angle
-                servo.Gripper.write(servo.newDegree);
-            }
+}
 
-            // Set old time and degrees for new calculation
-            servo.oldTime = millis();
-            servo.oldDegrees = servo.newDegree;
+void NeuroBoard::setEnvelopeEngine(const int& engine, const uint16_t& milliseconds, const int& zeroLevel) {
 
-        }
+    noInterrupts();
+
+    envelopeEngine = engine;
+    envelopeMs = milliseconds;
+    envelopeShift = timeConstantShiftMs(milliseconds, this->getSampleRate());
+    envelopeZero = zeroLevel;
 
+    // Start every channel from silence //
+
+    for (uint8_t slot = 0; slot < MAX_CHANNELS; slot++) {
+        envelopeAcc[slot] = 0;
+        envelopeValue[slot] = 0;
     }
 
-    // EMG Strength Code //
+    interrupts();
 
-    if (emgStrengthEnabled) {
+}
 
-        // Turn OFF all LEDs on LED bar
-        for (int i = 0; i < MAX_LEDS; i++) {
-            this->writeLED(this->ledPins[i], OFF);
-        }
+void NeuroBoard::setDecayRate(const int& rate) {
 
-        // Calculate what LEDs should be turned ON on the LED bar
-        int readings = constrain(reading, 30, servo.emgSaturationValue);
-        servo.ledbarHeight = fasterMap(readings, 30, servo.emgSaturationValue, 0, MAX_LEDS);
+    // Check to ensure positive input, some users may interpret decay rate
+    // as a negative value. This prevents that mistake.
 
-        // Display fix for when servo is disabled, but user still wants visual feedback
-        // Last check is for a Leonardo Board. Not tested with an Arduino Uno yet.
-        if (!servoEnabled and servo.ledbarHeight == 7 and MAX_LEDS == 8) {
-            servo.ledbarHeight++;
-        }
+    NeuroBoard::decayRate = (rate < 0) ? -rate : rate;
 
-        // Turn ON LEDs on the LED bar
-        for (int i = 0; i < servo.ledbarHeight; i++) {
-            this->writeLED(this->ledPins[i], ON);
-        }
+}
+
+/**
+ * Starts catching button edges, the first time a button callback is enabled.
+**/
+void startButtons(void) {
+
+    if (buttonsStarted) return;
 
+    noInterrupts();
+    for (uint8_t index = 0; index < BUTTON_COUNT; index++) {
+        buttonReported[index] = buttonPressed(index);
+        buttonEdgeTime[index] = millis();
+        buttonState[index].down = buttonReported[index];
+        if (buttonReported[index]) buttonsDown |= 1 << index;
     }
+    buttonsStarted = true;
+    interrupts();
+
+    attachInterrupt(digitalPinToInterrupt(7), whiteButtonEdge, CHANGE); // WHITE_BTN is D7
 
 }
 
-void NeuroBoard::startServo(void) {
+bool NeuroBoard::addGesture(const uint8_t& buttons, const uint8_t& gesture, const uint16_t& value, void (*callback)(void)) {
 
-    // Ensure servo isn't already enabled before starting
-    if (servoEnabled) return;
+    uint8_t all = (1 << BUTTON_COUNT) - 1;
+    bool single = (buttons & (buttons - 1)) == 0;
 
-    // Attach servo to board
-    servo.Gripper.attach(SERVO_PIN);
+    if (gestureCount >= MAX_GESTURES || !buttons || (buttons & ~all)) return false;
+    if (gesture > HOLD_REPEAT_GESTURE) return false;
+    if (gesture == MULTI_PRESS_GESTURE && (!single || value < 1)) return false;
 
-    PORTD = PORTD & I_BITMASK_ONE; // digitalWrite(RELAY_PIN, OFF);
+    gestures[gestureCount++].set(buttons, gesture, value, callback);
 
-    // Initialize all LED pins to output
-    for (int i = 0; i < MAX_LEDS; i++) {
-        pinMode(this->ledPins[i], OUTPUT);
+    // Presses of a button are counted up to the largest multi press it takes //
+
+    if (single && (gesture == PRESS_GESTURE || gesture == MULTI_PRESS_GESTURE)) {
+        for (uint8_t index = 0; index < BUTTON_COUNT; index++) {
+            uint8_t presses = (gesture == PRESS_GESTURE) ? 1 : value;
+            if ((buttons & (1 << index)) && presses > buttonState[index].maxPresses) buttonState[index].maxPresses = presses;
+        }
     }
 
-    // Get current sensitivity
-    servo.emgSaturationValue = servo.sensitivities[servo.lastSensitivitiesIndex];
+    startButtons();
 
-    // Set servo enabled boolean
-    servoEnabled = true;
+    return true;
 
 }
 
-void NeuroBoard::endServo(void) {
+void NeuroBoard::enableButtonPress(const uint8_t& button, void (*callback)(void)) {
 
-    // Ensure servo is enabled before disabling
-    if (!servoEnabled) return;
+    int8_t index = buttonIndex(button);
+    if (index < 0) return;
 
-    // Set servo boolean value to false
-    servoEnabled = false;
+    this->addGesture(1 << index, PRESS_GESTURE, 0, callback);
 
-    // Detach servo
-    servo.Gripper.detach();
+}
 
-    // Reset servo object to default values
-    servo = NeuroServo();
+void NeuroBoard::enableButtonDoublePress(const uint8_t& button, void (*callback)(void)) {
 
-}
+    int8_t index = buttonIndex(button);
+    if (index < 0) return;
 
-void NeuroBoard::increaseSensitivity(void) {
+    this->addGesture(1 << index, MULTI_PRESS_GESTURE, 2, callback);
 
-    // Ensure servo is enabled before modifying sensitivity value
-    if (!servoEnabled || servo.lastSensitivitiesIndex == 5) return; // 5 equals end of sensitivity array
+}
 
-    // Increment sensitivity index
-    servo.lastSensitivitiesIndex++;
+void NeuroBoard::enableButtonLongPress(const uint8_t& button, const int& milliseconds, void (*callback)(void)) {
 
-    // Get current sensitivity value
-    servo.emgSaturationValue = servo.sensitivities[servo.lastSensitivitiesIndex];
+    int8_t index = buttonIndex(button);
+    if (index < 0) return;
+
+    this->addGesture(1 << index, LONG_PRESS_GESTURE, milliseconds, callback);
 
 }
 
-void NeuroBoard::decreaseSensitivity(void) {
+int8_t NeuroBoard::addTrigger(const uint8_t& channel, const int& threshold, const int& hysteresis, const uint8_t& edge, void (*callback)(void), const bool& relay) {
 
-    // Ensure servo is enabled before modifying sensitivity value
-    if (!servoEnabled || servo.lastSensitivitiesIndex == 0) return;
+    // Reuse the first free entry, so the table stays packed //
 
-    // Decrement sensitivity index
-    servo.lastSensitivitiesIndex--;
+    uint8_t id = 0;
+    while (id < triggerCount && triggers[id].enabled) id++;
+    if (id >= MAX_TRIGGERS) return -1;
 
-    // Get current sensitivity value
-    servo.emgSaturationValue = servo.sensitivities[servo.lastSensitivitiesIndex];
+    Trigger& trigger = triggers[id];
 
-}
+    // A falling edge trigger starts out fired, so it can't go off before the envelope has risen //
 
-void NeuroBoard::setServoDefaultPosition(const int& position) {
+    int secondThreshold = (edge == RISING_EDGE) ? (threshold - hysteresis) : (threshold + hysteresis);
 
-    servo.currentFunctionality = position;
+    noInterrupts(); // The sample interrupt checks the table
 
-}
+    trigger.set(threshold, secondThreshold, callback, false, edge == FALLING_EDGE);
+    trigger.channel = channel;
+    trigger.slot = triggerSlot(channel);
+    trigger.edge = edge;
+    trigger.relay = relay;
+    trigger.generation++;
+    trigger.enabled = true;
 
-int NeuroBoard::getNewSample(void) {
+    if (id == triggerCount) triggerCount++;
 
-    int value = buffer[tail]; // Can't just return this because tail is changed below //
-    full = false;
-    tail = (tail == BUFFER_SIZE) ? (0) : (tail + 1);
+    interrupts();
 
-    return value;
+    return id;
 
 }
 
-void NeuroBoard::getSamples(int* arr[], const int& size) {
+TriggerEvent NeuroBoard::getLastTriggerEvent(void) {
 
-    *arr = new int[size];
-    for (int i = 0; i < size; i++) {
-        // We can't just access the buffer directly because we need to modify it once retrieving a value.
-        (*arr)[i] = this->getNewSample();
-    }
+    return lastTriggerEvent;
 
 }
 
-int NeuroBoard::getEnvelopeValue(void) {
+void NeuroBoard::removeTrigger(const int8_t& id) {
 
-    return envelopeValue;
+    if (id < 0 || id >= triggerCount) return;
+
+    noInterrupts();
+    triggers[id].enabled = false;
+    while (triggerCount && !triggers[triggerCount - 1].enabled) triggerCount--;
+    interrupts();
 
 }
 
-void NeuroBoard::setChannel(const uint8_t& newChannel) {
+int8_t NeuroBoard::setTriggerOnEnvelope(const int& threshold, const int& secondFactor, void (*callback)(void)) {
 
-    NeuroBoard::channel = newChannel;
+    return this->addTrigger(PRIMARY_CHANNEL, threshold, threshold - secondFactor, RISING_EDGE, callback, true);
 
 }
 
-void NeuroBoard::setDecayRate(const int& rate) {
-
-    // Check to ensure positive input, some users may interpret decay rate
-    // as a negative value. This prevents that mistake.
+int8_t NeuroBoard::setTriggerOnEnvelope(const int& threshold, void (*callback)(void)) {
 
-    NeuroBoard::decayRate = (rate < 0) ? -rate : rate;
+    return this->setTriggerOnEnvelope(threshold, threshold - (threshold / 10), callback);
 
 }
 
-void NeuroBoard::enableButtonPress(const uint8_t& button, void (*callback)(void)) {
+ulong NeuroBoard::setRelayPulse(const ulong& widthMicros, const uint8_t& count, const ulong& intervalMicros) {
 
-    if (button == RED_BTN) {
-        redButtonTrigger.set(callback, 0, true);
-    }
+    if (widthMicros == 0) return 0;
 
-    if (button == WHITE_BTN) {
-        whiteButtonTrigger.set(callback, 0, true);
-    }
+    uint16_t width = sampleTicks(widthMicros, timerPrescaler, timerTop);
+    uint16_t interval = sampleTicks(intervalMicros, timerPrescaler, timerTop);
+
+    // A running train picks up the new shape at its next edge //
+
+    noInterrupts();
+    relayWidthUs = widthMicros;
+    relayIntervalUs = intervalMicros;
+    relayCount = count;
+    relayWidthTicks = width;
+    relayIntervalTicks = interval;
+    interrupts();
+
+    return (ulong)width * timerPrescaler * (timerTop + 1UL) / (F_CPU / 1000000UL);
 
 }
 
-void NeuroBoard::enableButtonLongPress(const uint8_t& button, const int& milliseconds, void (*callback)(void)) {
+bool NeuroBoard::pulseRelay(void) {
 
-    if (button == RED_BTN) {
-        redLongButtonTrigger.set(callback, milliseconds, true);
-    }
+    if (!timerStarted) return false;
 
-    if (button == WHITE_BTN) {
-        whiteLongButtonTrigger.set(callback, milliseconds, true);
+    bool started = false;
+    noInterrupts();
+    if (!relayRunning) {
+        startRelay();
+        started = true;
     }
+    interrupts();
+
+    return started;
 
 }
 
-void NeuroBoard::setTriggerOnEnvelope(const int& threshold, const int& secondFactor, void (*callback)(void)) {
+void NeuroBoard::stopRelay(void) {
 
-    envelopeTrigger.set(threshold, secondFactor, callback, true, false);
+    noInterrupts();
+    relayRunning = false;
+    relayOn = false;
+    PORTD = PORTD & I_BITMASK_ONE; // digitalWrite(RELAY_PIN, OFF);
+    interrupts();
 
 }
 
-void NeuroBoard::setTriggerOnEnvelope(const int& threshold, void (*callback)(void)) {
+bool NeuroBoard::isRelayPulsing(void) {
 
-    this->setTriggerOnEnvelope(threshold, threshold - (threshold / 10), callback);
+    return relayRunning;
 
 }
 
@@ -522,6 +1938,9 @@ void NeuroBoard::displayEMGStrength(void) {
 
     emgStrengthEnabled = !emgStrengthEnabled;
 
+    // Clear the bar once, from here on writeLEDBar only writes changes
+    if (emgStrengthEnabled) this->writeLEDs(0);
+
 }
 
 bool wait(const int& milliseconds, ulong& variable) {
@@ -534,49 +1953,107 @@ bool wait(const int& milliseconds, ulong& variable) {
 
 }
 
+void NeuroBoard::writeLEDBar(const uint8_t& height) {
+
+    byte bitmap = ledBarBitmap((height > MAX_LEDS) ? MAX_LEDS : height);
+
+    if (bitmap == this->_shiftRegState) return;
+
+    this->writeLEDs(bitmap);
+
+}
+
 /* ******************************************************* */
 /** @author Stanislav Mircic **/
 /** Simplified by Ben Antonellis **/
 
 void NeuroBoard::writeLEDs(void) {
 
-    PORTB &= I_SHIFT_LATCH_PIN;
-    byte tempBitmask = BITMASK_ONE;
+    this->writeLEDs(_shiftRegState);
 
-    for (int i = 0; i < MAX_LEDS; i++) {
+}
 
-        PORTB = (_shiftRegState & tempBitmask) ? (PORTB | SHIFT_DATA_PIN) : (PORTB & I_SHIFT_DATA_PIN);
+#ifdef NEUROBOARD_LED_SPI
 
-        //pulse the clock for shift
-        PORTB |= SHIFT_CLOCK_PIN;
-        PORTB &= I_SHIFT_CLOCK_PIN;
-        tempBitmask <<= 1;
+void NeuroBoard::writeLEDs(byte outByte) {
+
+    _shiftRegState = outByte;
+
+    // The register keeps the last bits shifted in, so with fewer than 8 LEDs //
+    // the bar's bits go last and the padding falls off the end.            //
 
+    byte bits = outByte << (8 - MAX_LEDS);
+
+    // Master, LSB first like the bit-banged path, mode 0, F_CPU / 2. SS (PB0) stays //
+    // an output, as an input pulled low would drop the SPI out of master mode.     //
+
+    if (!(SPCR & _BV(SPE))) {
+        DDRB |= LED_SPI_LATCH_PIN | SHIFT_CLOCK_PIN | SHIFT_LATCH_PIN | B00000001; // Latch, SCK (PB1), MOSI (PB2) and SS as outputs
+        SPSR = _BV(SPI2X);
+        #ifdef NEUROBOARD_LED_SPI_INTERRUPT
+            SPCR = _BV(SPE) | _BV(MSTR) | _BV(DORD) | _BV(SPIE);
+        #else
+            SPCR = _BV(SPE) | _BV(MSTR) | _BV(DORD);
+        #endif
     }
 
-    PORTB |= SHIFT_LATCH_PIN;
+    #ifdef NEUROBOARD_LED_SPI_INTERRUPT
+
+        noInterrupts();
+
+        if (ledTransferring) {
+            ledQueuedByte = bits; // Newer state replaces whatever was queued
+            ledQueued = true;
+        } else {
+            ledTransferring = true;
+            PORTB &= ~LED_SPI_LATCH_PIN;
+            SPDR = bits;
+        }
+
+        interrupts();
+
+    #else
+
+        // Only loop() writes the LEDs, so the transfer can't be interrupted by another one //
+
+        PORTB &= ~LED_SPI_LATCH_PIN;
+        SPDR = bits;
+        while (!(SPSR & _BV(SPIF)));
+        PORTB |= LED_SPI_LATCH_PIN;
+
+    #endif
+
 }
 
+#else
+
 void NeuroBoard::writeLEDs(byte outByte) {
 
     PORTB &= I_SHIFT_LATCH_PIN;
     _shiftRegState = outByte;
-    byte tempBitmask = BITMASK_ONE;
 
-    for (int i = 0; i < MAX_LEDS; i++) {
+    // Each line below is a single sbi/cbi, which ISRs touching other PORTB pins can't disturb //
 
-        PORTB = (outByte & tempBitmask) ? (PORTB | SHIFT_DATA_PIN) : (PORTB & I_SHIFT_DATA_PIN);
+    for (uint8_t i = 0; i < MAX_LEDS; i++) {
+
+        if (outByte & BITMASK_ONE) {
+            PORTB |= SHIFT_DATA_PIN;
+        } else {
+            PORTB &= I_SHIFT_DATA_PIN;
+        }
 
         //pulse the clock for shift
         PORTB |= SHIFT_CLOCK_PIN;
         PORTB &= I_SHIFT_CLOCK_PIN;
-        tempBitmask <<= 1;
+        outByte >>= 1;
 
     }
 
     PORTB |= SHIFT_LATCH_PIN;
 }
 
+#endif
+
 void NeuroBoard::writeLED(const int& led, const bool& state) {
 
     const int LED = this->ledPins[led];
@@ -38,16 +38,82 @@
 
 #include "Arduino.h"
 #include <Servo.h>
+#include "NeuroRingBuffer.hpp"
+#include "NeuroDSP.hpp"
 
 // Defines //
 
+/**
+ * Defines wrapped in #ifndef can be overridden with build flags, which reach
+ * NeuroBoard.cpp too. A #define in the sketch only changes what the sketch
+ * sees, not the library.
+**/
+
 #define NEUROBOARD_VERSION 	0.8
 #define RED_BTN         	DD4
 #define WHITE_BTN       	DD7
 #define ON              	HIGH
 #define OFF             	LOW
-#define BUFFER_SIZE     	20
+#define BUFFER_SIZE     	16                  // Default samples per channel, see BufferedNeuroBoard
+#ifndef SKETCH_RAM_RESERVE
+    #define SKETCH_RAM_RESERVE 768              // RAM (bytes) left for the Arduino core, the stack and the sketch, see SAMPLE_RAM_BUDGET
+#endif
+#define SAMPLE_OVERRUN_POLICY OVERWRITE_OLDEST  // Keep the newest samples when loop() falls behind
+#define MAX_CHANNELS        6                   // A0 - A5
 #define SERIAL_CAP      	230400
+#define STREAM_CHUNK_SIZE   64                  // Most bytes handed to Serial at once, one USB packet
+#ifndef TX_BUFFER_SIZE
+    #define TX_BUFFER_SIZE  128                 // Bytes queued by ISR_STREAMING, power of two, 0 leaves ISR_STREAMING out
+#endif
+#define LOOP_STREAMING      1
+#define ISR_STREAMING       2
+#define BLOCKING_SAMPLING   0
+#define ASYNC_SAMPLING      1
+#define DEFAULT_SAMPLE_RATE 250
+#define ADC_PRESCALER       16                  // Set in startMeasurements, ADC clock = F_CPU / 16
+#define ADC_CONVERSION_CLKS 13                  // ADC clocks per conversion
+#define MIN_SAMPLE_RATE     1
+#define MAX_SAMPLE_RATE     (F_CPU / ADC_PRESCALER / ADC_CONVERSION_CLKS / 2) // Half the ADC throughput, leaves room for the ISR and loop()
+#define PEAK_DECAY_ENVELOPE 0                   // Follows peaks, drops by decayRate every sample
+#define PEAK_HOLD_ENVELOPE  1                   // Follows peaks, decays exponentially
+#define LOWPASS_ENVELOPE    2                   // Rectified signal through a single pole lowpass
+#define RMS_ENVELOPE        3                   // Root mean square
+#define RMS_UPDATE_INTERVAL 8                   // Ticks between square roots of RMS_ENVELOPE, power of two
+#ifndef WINDOW_MAX_SIZE
+    #define WINDOW_MAX_SIZE 32                  // Most samples setWindowSize accepts, power of two
+#endif
+#define CIC_ORDER           3                   // Integrator/comb stages of the decimator
+#define MAX_DECIMATION      64                  // Largest factor setDecimation accepts, gain must fit 32 bits
+#ifndef DECIMATED_BUFFER_SIZE
+    #define DECIMATED_BUFFER_SIZE 16            // Decimated samples kept for loop(), power of two
+#endif
+#define NOTCH_OFF           0
+#define NOTCH_AUTO          1                   // Measure 50 Hz and 60 Hz, then notch the stronger one
+#define NOTCH_BANDWIDTH     4                   // Width of the notch in Hz
+#define NOTCH_CALIBRATION_MS 250                // Length of the NOTCH_AUTO measurement
+#define ADC_MAX             1023                // Largest reading, filtered samples are kept within 0 and ADC_MAX
+#define MAX_TRIGGERS        5                   // Envelope triggers that can be active at once
+#define RISING_EDGE         0
+#define FALLING_EDGE        1
+#define PRIMARY_CHANNEL     0xFF                // Follows the first scanned channel, see setChannels
+#ifndef TRIGGER_QUEUE_SIZE
+    #define TRIGGER_QUEUE_SIZE 8                // Trigger events waiting for handleInputs, power of two
+#endif
+#define BUTTON_COUNT        2                   // RED_BTN and WHITE_BTN
+#ifndef BUTTON_QUEUE_SIZE
+    #define BUTTON_QUEUE_SIZE 8                 // Button edges waiting for handleInputs, power of two
+#endif
+#define BUTTON_DEBOUNCE_MS  20                  // Edges this soon after the last one are contact bounce
+#define SHORT_PRESS_MS      250                 // Longest press that counts as a press
+#define DOUBLE_PRESS_MS     300                 // Longest gap between the presses of a double press
+#define HOLD_REPEAT_DELAY_MS 500                // Hold before HOLD_REPEAT_GESTURE starts repeating
+#define MAX_GESTURES        8                   // Entries in the button gesture table
+#define RED_BTN_MASK        0x01                // Buttons of a gesture, see addGesture
+#define WHITE_BTN_MASK      0x02
+#define PRESS_GESTURE       0
+#define MULTI_PRESS_GESTURE 1
+#define LONG_PRESS_GESTURE  2
+#define HOLD_REPEAT_GESTURE 3
 
 #ifdef ARDUINO_AVR_UNO
     #define MAX_LEDS 6
@@ -55,7 +121,33 @@
     #define MAX_LEDS 8
 #endif
 
+// LED shift register backend //
+
+/**
+ * The LED bar's shift register is wired to PB1 (clock), PB2 (latch) and PB3
+ * (data), and writeLEDs bit-bangs those pins. Hardware SPI shifts data out of
+ * MOSI, which is PB2 on the 32U4, so it only works on a board with the
+ * register's SER on PB2 (MOSI), SRCLK on PB1 (SCK) and RCK on the PORTB pin
+ * in LED_SPI_LATCH_PIN (PB4, D8, by default). Define NEUROBOARD_LED_SPI, as a
+ * build flag or below, for such a board.
+ * 
+ * PB0 (SS) isn't a good latch: the Leonardo core blinks the RX LED on it
+ * whenever USB data arrives. It is still made an output, as SPI master mode
+ * requires.
+ * 
+ * writeLEDs sends the byte through SPDR and waits for it, 8 bits at F_CPU / 2
+ * take 16 cycles. Define NEUROBOARD_LED_SPI_INTERRUPT as well to have the SPI
+ * interrupt latch the byte instead, so writeLEDs never waits for the transfer.
+**/
+// #define NEUROBOARD_LED_SPI
+// #define NEUROBOARD_LED_SPI_INTERRUPT
+
+#ifndef LED_SPI_LATCH_PIN
+    #define LED_SPI_LATCH_PIN   B00010000       // latch pin for shift register RCK - PB4 (NEUROBOARD_LED_SPI only)
+#endif
+
 typedef unsigned long ulong;
+typedef RingBuffer<int16_t, SAMPLE_OVERRUN_POLICY>::Span SampleSpan;
 
 // analogRead macros //
 
@@ -77,14 +169,63 @@ typedef unsigned long ulong;
   * Ported/Updated by Ben Antonellis
 **/
 
-#define RELAY_PIN                 3             // Pin for relay that controls TENS device
+#define RELAY_PIN                 3             // Pin for relay that controls TENS device (PD0 on the Leonardo)
+#define RELAY_PULSE_US            1000          // Default relay pulse width, rounded to whole sample ticks, see setRelayPulse
+#define CONTINUOUS_PULSES         0             // Pulse count that repeats until stopRelay
 #define RELAY_THRESHOLD           4             // Defines sensitivity of relay
 #define SERVO_PIN                 2             // Pin for servo motor
 #define NUM_LED                   6             // Number of LEDs in LED bar
-#define GRIPPER_MINIMUM_STEP      5             // 5 degree dead zone (used to avoid aiming oscilation)
+#define GRIPPER_MINIMUM_STEP      5             // 5 degree dead zone (used to avoid aiming oscilation), see setServoDeadband
 #define OPEN_MODE                 1             // Default gripper state is opened
 #define CLOSED_MODE               2             // Default gripper state is closed
-#define MINIMUM_SERVO_UPDATE_TIME 100           // Update servo position every 100ms
+#define SERVO_FRAME_US            REFRESH_INTERVAL // Update servo position once per servo frame (20ms)
+#define SERVO_SLEW_RATE           360           // Default fastest gripper movement, degrees per second
+#define SERVO_ENVELOPE_INPUT      0             // Servo follows the envelope of the first scanned channel
+#define SERVO_READING_INPUT       1             // Servo follows the latest sample
+#define SENSITIVITY_LEVELS        6             // Entries of NeuroServo::sensitivities
+#define KERNEL_MAPPING            0             // Readings are mapped by MapKernel, kernels live in RAM
+#define TABLE_MAPPING             1             // Readings are looked up in PROGMEM tables, see SensitivityTables
+#define MAP_TABLE_SIZE            128           // Entries per table, spread over the readings up to the sensitivity
+
+/**
+ * SERVO_MAPPING picks the mapping backend of NeuroBoard.cpp, so it has to be
+ * a build flag (or set here). A #define in the sketch doesn't reach the
+ * library, which is compiled on its own. Its state lives in NeuroBoard.cpp,
+ * so NeuroServo and LIBRARY_STATIC_RAM are the same whichever is picked.
+**/
+#ifndef SERVO_MAPPING
+    #define SERVO_MAPPING         KERNEL_MAPPING // Mapping backend of the servo and LED bar code
+#endif
+
+/**
+ * EMG saturation value of a sensitivity level (when EMG reaches this value
+ * the gripper will be fully opened/closed).
+**/
+constexpr int servoSensitivity(const uint8_t level) {
+    return (level == 0) ? 200 : (level == 1) ? 350 : (level == 2) ? 520 : (level == 3) ? 680 : (level == 4) ? 840 : 1024;
+}
+
+/**
+ * One mapping of the readings for every sensitivity level, built at compile time.
+**/
+struct SensitivityTables {
+    MapTable<MAP_TABLE_SIZE> levels[SENSITIVITY_LEVELS];
+};
+
+template <uint8_t... L>
+constexpr SensitivityTables makeSensitivityTables(const int fromLow, const int toLow, const int toHigh, IndexList<L...>) {
+    return SensitivityTables{{ mapTable<MAP_TABLE_SIZE>(fromLow, servoSensitivity(L), toLow, toHigh)... }};
+}
+
+/**
+ * Tables mapping fromLow - sensitivity onto toLow - toHigh, for PROGMEM. Each
+ * level spreads its entries over its own range, so the low sensitivities get
+ * one or two readings per entry and every level stays within one of the
+ * exact mapping.
+**/
+constexpr SensitivityTables sensitivityTables(const int fromLow, const int toLow, const int toHigh) {
+    return makeSensitivityTables(fromLow, toLow, toHigh, MakeIndexList<SENSITIVITY_LEVELS>::Type());
+}
 
 /**
  * Struct for maintaining the servo during its usage.
@@ -96,16 +237,16 @@ struct NeuroServo {
     Servo Gripper;                              // Servo for gripper
     
     //EMG saturation values (when EMG reaches this value the gripper will be fully opened/closed)
-    int sensitivities[6] = {200, 350, 520, 680, 840, 1024};
+    int sensitivities[SENSITIVITY_LEVELS] = {servoSensitivity(0), servoSensitivity(1), servoSensitivity(2),
+                                             servoSensitivity(3), servoSensitivity(4), servoSensitivity(5)};
     int lastSensitivitiesIndex = 4;             // Set initial sensitivity index
     
     int emgSaturationValue = 1024;              // Selected sensitivity/EMG saturation value
-    int analogReadings;                         // Measured value for EMG
     byte ledbarHeight = 0;                      // Temporary variable for led bar height
     
-    ulong oldTime = 0;                          // Timestamp of last servo angle update (ms)
-    int oldDegrees = 0;                         // Old value of angle for servo
-    int newDegree;                              // New value of angle for servo
+    int16_t position = DEFAULT_PULSE_WIDTH;     // Pulse width written to the servo (us), sample interrupt only
+    int16_t goal = DEFAULT_PULSE_WIDTH;         // Pulse width being moved to, changes only past the dead zone
+    uint16_t ticksLeft = 1;                     // Sample ticks until the next servo frame
     
     ulong debouncerTimer = 0;                   // Timer for button debouncer         
     int gripperStateButtonValue = 0;            // Temporary variable that stores state of button 
@@ -115,29 +256,77 @@ struct NeuroServo {
 
 };
 
+// Bytes taken by the mapping backend's data, the code of either is a few dozen bytes //
+
+#if SERVO_MAPPING == TABLE_MAPPING
+    #define SERVO_MAPPING_RAM     1
+    #define SERVO_MAPPING_FLASH   (3 * sizeof(SensitivityTables))
+#else
+    #define SERVO_MAPPING_RAM     (3 * sizeof(MapKernel))
+    #define SERVO_MAPPING_FLASH   0
+#endif
+
 // Servo Code End //
 
 /**
- * Struct for better handling of buttons and their callbacks.
+ * Struct for one entry of the button gesture table, see addGesture.
 **/
-struct Button {
+struct Gesture {
 
+    uint8_t buttons;                            // RED_BTN_MASK, WHITE_BTN_MASK or both (a chord)
+    uint8_t type;                               // PRESS_GESTURE, MULTI_PRESS_GESTURE, ...
+    uint16_t value;                             // Press count, hold time or repeat period
     void (*callback)(void);
-    unsigned int interval;
     bool enabled;
+    bool fired;                                 // Long press or chord already called for this hold
+    ulong next;                                 // millis() of the next hold repeat
 
-    Button() {};
+    Gesture() : enabled(false) {};
 
-    void set(void (*callback)(void), const int& interval, const bool& enabled) {
+    void set(const uint8_t& buttons, const uint8_t& type, const uint16_t& value, void (*callback)(void)) {
+        this->buttons = buttons;
+        this->type = type;
+        this->value = value;
         this->callback = callback;
-        this->interval = interval;
-        this->enabled = enabled;
+        this->enabled = true;
+        this->fired = false;
     }
 
 };
 
 /**
- * Struct for handling trigger events.
+ * Struct for a debounced button edge, timestamped by the interrupt that saw it.
+**/
+struct ButtonEvent {
+
+    uint8_t button = 0;                         // 0 for RED_BTN, 1 for WHITE_BTN
+    bool pressed = false;                       // Pressed or released
+    ulong time = 0;                             // millis() of the edge
+
+    ButtonEvent() {};
+
+};
+
+/**
+ * Struct for the gesture state of one button, shared by every gesture using it.
+**/
+struct ButtonState {
+
+    ulong downTime = 0;                         // millis() of the last press
+    ulong upTime = 0;                           // millis() of the last release
+    uint8_t presses = 0;                        // Short presses waiting to be counted
+    uint8_t maxPresses = 0;                     // Most presses any gesture of this button counts
+    bool down = false;
+    bool consumed = false;                      // This press was used by a long press, hold repeat or chord
+
+    ButtonState() {};
+
+};
+
+/**
+ * Struct for handling trigger events. The trigger fires when the envelope
+ * crosses threshold in the direction of edge, then rearms once it has moved
+ * back past secondThreshold.
 **/
 struct Trigger {
 
@@ -146,8 +335,13 @@ struct Trigger {
     void (*callback)(void);
     bool enabled;
     bool thresholdMet;
+    uint8_t channel;                            // A0 - A5 or PRIMARY_CHANNEL
+    int8_t slot;                                // Scan slot of channel, -1 while it isn't scanned
+    uint8_t edge;                               // RISING_EDGE or FALLING_EDGE
+    bool relay;                                 // Pulse the relay when fired
+    uint8_t generation;                         // Counts reuses of the entry, see TriggerEvent
 
-    Trigger() {};
+    Trigger() : enabled(false), generation(0) {};
 
     void set(const int& threshold, const int& secondThreshold, void (*callback)(void), const bool& enabled, const bool& thresholdMet) {
         this->threshold = threshold;
@@ -159,6 +353,169 @@ struct Trigger {
 
 };
 
+/**
+ * Struct describing one firing of an envelope trigger, recorded by the sample
+ * interrupt on the tick the threshold was crossed. See getLastTriggerEvent.
+**/
+struct TriggerEvent {
+
+    uint8_t trigger = 0;                        // Id returned by addTrigger
+    int level = 0;                              // Envelope value that crossed the threshold
+    ulong sequence = 0;                         // Tick of the crossing, see AcquisitionStats::sequence
+    ulong micros = 0;                           // micros() at that tick
+    uint8_t generation = 0;                     // Trigger::generation when it fired, events of a removed trigger don't reach its successor
+
+    TriggerEvent() {};
+
+};
+
+/**
+ * Struct for reporting the health of background sampling. See getStats.
+**/
+struct AcquisitionStats {
+
+    ulong samplesProduced = 0;                  // Samples placed in the buffers, all channels
+    ulong samplesConsumed = 0;                  // Samples taken out by getNewSample/readSamples/commitSamples
+    uint16_t overruns = 0;                      // Samples overwritten before loop() read them
+    uint16_t underruns = 0;                     // getNewSample calls that found no new sample
+    uint16_t maxISRCycles = 0;                  // Most cycles spent on one tick
+    uint16_t avgISRCycles = 0;                  // Running average of cycles per tick
+    ulong sequence = 0;                         // Sequence number of the newest tick, never goes backwards
+    uint16_t eventsDropped = 0;                 // Trigger events lost because handleInputs wasn't called
+
+    AcquisitionStats() {};
+
+};
+
+/**
+ * Struct for reporting the servo engine, see getServoStats.
+**/
+struct ServoStats {
+
+    ulong frames = 0;                           // Servo frames computed since startServo
+    int target = 0;                             // Angle the input asks for
+    int angle = 0;                              // Angle written, after the dead zone and slew limit
+    uint16_t latency = 0;                       // Microseconds from the sample tick to the servo write
+    uint16_t maxLatency = 0;
+
+    ServoStats() {};
+
+};
+
+/**
+ * Struct for reporting backpressure while streaming. See getStreamStats.
+**/
+struct StreamStats {
+
+    ulong bytesSent = 0;                        // Bytes handed to Serial
+    uint16_t framesDropped = 0;                 // Frames that didn't fit the TX buffer (ISR_STREAMING)
+    uint16_t stalls = 0;                        // Times the serial port had no room for queued bytes (ISR_STREAMING)
+    uint8_t maxQueued = 0;                      // Highest TX buffer fill seen, out of TX_BUFFER_SIZE
+    uint8_t queued = 0;                         // Bytes waiting in the TX buffer right now
+
+    StreamStats() {};
+
+};
+
+/**
+ * Shift register bits of an LED bar lit up to height, the same bits writeLED
+ * sets for LEDs 0 to height - 1.
+**/
+constexpr byte ledBarBitmap(const uint8_t height) {
+    return (byte)(0xFF00 >> height);
+}
+
+// Sample Rate Calculations //
+
+/**
+ * Smallest Timer3 prescaler that fits the requested rate into the 16 bit OCR3A.
+**/
+constexpr uint16_t sampleRatePrescaler(const ulong hz) {
+    return (F_CPU / 1UL / hz <= 65536UL) ? 1 :
+           (F_CPU / 8UL / hz <= 65536UL) ? 8 :
+           (F_CPU / 64UL / hz <= 65536UL) ? 64 :
+           (F_CPU / 256UL / hz <= 65536UL) ? 256 : 1024;
+}
+
+/**
+ * CS32:0 bits for the passed Timer3 prescaler.
+**/
+constexpr uint8_t sampleRateClockSelect(const uint16_t prescaler) {
+    return (prescaler == 1) ? 1 : (prescaler == 8) ? 2 : (prescaler == 64) ? 3 : (prescaler == 256) ? 4 : 5;
+}
+
+/**
+ * OCR3A value (CTC mode TOP) closest to the requested rate.
+**/
+constexpr uint16_t sampleRateTop(const ulong hz, const uint16_t prescaler) {
+    return (F_CPU / prescaler + hz / 2) / hz - 1;
+}
+
+/**
+ * Rate actually produced by a prescaler and TOP pair.
+**/
+constexpr float sampleRateAchieved(const uint16_t prescaler, const uint16_t top) {
+    return (float)F_CPU / prescaler / (top + 1UL);
+}
+
+/**
+ * Clamps a tick count to what the relay pulse generator can count.
+**/
+constexpr uint16_t clampTicks(const ulong ticks) {
+    return (ticks < 1) ? 1 : (ticks > 0xFFFF) ? 0xFFFF : ticks;
+}
+
+/**
+ * Whole sample ticks closest to a duration in microseconds, at least 1.
+ * Durations up to about 268 seconds don't overflow.
+**/
+constexpr uint16_t sampleTicks(const ulong us, const uint16_t prescaler, const uint16_t top) {
+    return clampTicks((us * (F_CPU / 1000000UL) + prescaler * (top + 1UL) / 2) / (prescaler * (top + 1UL)));
+}
+
+/**
+ * Compile time Timer3 configuration for a sample rate. Rates the ADC cannot
+ * sustain for the number of scanned channels fail to compile.
+ * 
+ * Example: SampleRate<5000>::achieved == 5000.0
+**/
+template <ulong HZ, uint8_t CHANNELS = 1>
+struct SampleRate {
+
+    static_assert(HZ >= MIN_SAMPLE_RATE, "Sample rate is too low for Timer3");
+    static_assert(CHANNELS >= 1 && CHANNELS <= MAX_CHANNELS, "Channel count must be between 1 and MAX_CHANNELS");
+    static_assert(HZ * CHANNELS <= MAX_SAMPLE_RATE, "Sample rate is too high for the ADC prescaler");
+
+    static constexpr uint16_t prescaler = sampleRatePrescaler(HZ);
+    static constexpr uint8_t clockSelect = sampleRateClockSelect(prescaler);
+    static constexpr uint16_t top = sampleRateTop(HZ, prescaler);
+    static constexpr float achieved = sampleRateAchieved(prescaler, top);
+
+};
+
+template <ulong HZ, uint8_t CHANNELS> constexpr uint16_t SampleRate<HZ, CHANNELS>::prescaler;
+template <ulong HZ, uint8_t CHANNELS> constexpr uint8_t SampleRate<HZ, CHANNELS>::clockSelect;
+template <ulong HZ, uint8_t CHANNELS> constexpr uint16_t SampleRate<HZ, CHANNELS>::top;
+template <ulong HZ, uint8_t CHANNELS> constexpr float SampleRate<HZ, CHANNELS>::achieved;
+
+/**
+ * Compile time coefficients of the mains notch filter for a sample rate.
+ * HZ must be the rate the board samples at.
+ * 
+ * Example: NotchFilter<50, 5000>::coefficients
+**/
+template <uint8_t MAINS, ulong HZ>
+struct NotchFilter {
+
+    static_assert(MAINS == 50 || MAINS == 60, "Mains frequency must be 50 or 60 Hz");
+    static_assert(notchUsable(MAINS, HZ, NOTCH_BANDWIDTH), "Sample rate is too low to filter the mains frequency");
+
+    static constexpr BiquadCoefficients coefficients = notchCoefficients(MAINS, HZ, NOTCH_BANDWIDTH);
+
+};
+
+template <uint8_t MAINS, ulong HZ> constexpr BiquadCoefficients NotchFilter<MAINS, HZ>::coefficients;
+
 /**
  * Class for interacting with the Neuroduino Board.
 **/
@@ -171,6 +528,12 @@ class NeuroBoard {
         static uint8_t channel;
         static int decayRate;
 
+        /**
+         * Creates a board with BUFFER_SIZE samples of buffer for each of the
+         * MAX_CHANNELS channels (192 bytes). See BufferedNeuroBoard to pick other sizes.
+        **/
+        NeuroBoard(void);
+
         /**
          * Samples data to a circular buffer, and calculates envelope value 
          * all in the background. Sets pin modes for Stanislav's code.
@@ -183,13 +546,64 @@ class NeuroBoard {
         void startMeasurements(void);
 
         /**
-         * Special function to handle all button triggers, envelope triggers, and
-         * servo pings.
+         * Special function to handle all button triggers, envelope triggers, 
+         * servo pings and streaming.
          * 
          * @return void.
         **/
         void handleInputs(void);
 
+        /**
+         * Streams every sample to the serial port in the binary format used by
+         * the Backyard Brains SpikeRecorder, instead of printing them as text.
+         * 
+         * Format: every scanned channel takes two bytes per sample, 7 bits each
+         * (high bits first). The first byte of each frame (the first channel)
+         * has its top bit set, all other bytes have it cleared. A 10 bit sample
+         * always fits in two bytes, compared to up to 6 as text.
+         * 
+         * LOOP_STREAMING: Samples are taken out of the buffers and sent from
+         *                 handleInputs(), so getNewSample and readSamples won't see them.
+         * ISR_STREAMING:  The sample interrupt encodes each frame into a TX buffer and
+         *                 hands it to Serial in batches, so streaming keeps going while
+         *                 loop() is busy or in delay(). The sample buffers are left alone.
+         *                 See getStreamStats for backpressure counters. Builds with
+         *                 TX_BUFFER_SIZE 0 have no TX buffer and stream with
+         *                 LOOP_STREAMING instead.
+         * 
+         * See extras/decode_stream.py for a decoder.
+         * 
+         * - Usable in setup: true
+         * - Usable in loop: true
+         * 
+         * @param mode Either LOOP_STREAMING (default) or ISR_STREAMING.
+         * 
+         * @return void.
+        **/
+        void startStreaming(const int& mode = LOOP_STREAMING);
+
+        /**
+         * Returns backpressure counters for streaming: bytes sent, frames dropped
+         * because the TX buffer was full, times the serial port had no room, and
+         * how full the TX buffer is and has been.
+         * 
+         * - Usable in setup: false
+         * - Usable in loop: true
+         * 
+         * @return StreamStats - Copy of the counters.
+        **/
+        StreamStats getStreamStats(void);
+
+        /**
+         * Stops streaming samples to the serial port. See startStreaming.
+         * 
+         * - Usable in setup: true
+         * - Usable in loop: true
+         * 
+         * @return void.
+        **/
+        void stopStreaming(void);
+
         /**
          * Sets up the servo for use with the NeuroBoard.
          * 
@@ -238,175 +652,894 @@ class NeuroBoard {
         void setServoDefaultPosition(const int& position);
 
         /**
-         * Returns the last measured sample from the channel.
+         * Limits how fast the gripper moves. The servo is updated by the sample
+         * interrupt once every servo frame (SERVO_FRAME_US), so the limit holds
+         * no matter how often loop() runs.
          * 
-         * - Usable in setup: false
+         * - Usable in setup: true
          * - Usable in loop: true
          * 
-         * @return int - Last measured sample.
+         * @param degreesPerSecond Fastest movement, 0 for no limit.
+         * 
+         * @return void.
         **/
-        int getNewSample(void);
-
-		/**
-		 * Returns "size" samples to the passed array.
-		 * 
-		 * - Usable in setup: false
-		 * - Usable in loop: true
-		 * 
-		 * Example Code:
-		 * 
-		 * void setup() {
-		 * 
-		 *     board.startMeasurements();
-		 * 
-		 * }
-		 * 
-		 * void loop() {
-		 * 
-		 *     int* samples;
-		 *     board.getSamples(&samples, 10);
-		 *     delete[] samples; // Frees memory for reallocation. REQUIRED.
-		 * 
-		 * }
-		 * 
-		 * @param arr Array to modify.
-		 * @param size Number of samples to add (should be same size as arr).
-		 * 
-		 * @return void.
-		**/
-		void getSamples(int* arr[], const int& size);
+        void setServoSlewRate(const uint16_t& degreesPerSecond);
 
         /**
-         * Returns the envelope value of the channel.
-         * 
-         * For every incoming reading from the analog, if that reading isn't bigger
-         * than the current envelope value, the envelope value is subtracted by one.
-         * This ensures we don't have an envelope value higher than necessary.
+         * Sets the dead zone of the gripper. The gripper only moves towards a new
+         * angle once it is more than this many degrees from the one it is moving to.
          * 
-         * - Usable in setup: false
+         * - Usable in setup: true
          * - Usable in loop: true
          * 
-         * @return int - Envelope value.
+         * @param degrees Dead zone, GRIPPER_MINIMUM_STEP by default.
+         * 
+         * @return void.
         **/
-        int getEnvelopeValue(void);
+        void setServoDeadband(const uint8_t& degrees);
 
         /**
-         * Sets the current channel to listen on. Works with A0, A1, A2 etc.
-		 * 
-         * Boundries for built in analogs:
-         *      setChannel(n) where:
-         *          A0 <= n <= A5
+         * Picks what the servo follows. The envelope (see setEnvelopeEngine) is
+         * smooth, the latest sample reacts faster but jitters.
          * 
          * - Usable in setup: true
          * - Usable in loop: true
          * 
-         * @param uint8_t Channel.
+         * @param input SERVO_ENVELOPE_INPUT or SERVO_READING_INPUT.
          * 
          * @return void.
         **/
-        void setChannel(const uint8_t& channel);
+        void setServoInput(const uint8_t& input);
 
         /**
-         * Sets the decay rate for the setTriggerOnEnvelope function.
-         * I.E, setDecayRate(5) will subtract envelopeValue by 5 every tick.
+         * Returns what the servo engine did in the last frame, and how long after
+         * the sample tick the servo was written. The envelope itself lags the
+         * signal by about its time constant, see setEnvelopeEngine.
+         * 
+         * - Usable in setup: false
+         * - Usable in loop: true
+         * 
+         * @return ServoStats - Copy of the servo statistics.
+        **/
+        ServoStats getServoStats(void);
+
+        /**
+         * Sets how many samples per second are taken in the background, per channel.
+         * Rates outside MIN_SAMPLE_RATE and MAX_SAMPLE_RATE (divided by the number
+         * of scanned channels) are rejected and the current rate is kept, as are
+         * rates too low for the notch filter while it is on (see setNotchFilter).
          * 
          * - Usable in setup: true
          * - Usable in loop: true
          * 
-         * @param rate Integer representing the scale at which envelopeValue will be subtracted.
+         * @param hz Requested samples per second.
          * 
-         * @return void.
+         * @return float - Rate actually achieved by the timer, 0 if rejected.
         **/
-        void setDecayRate(const int& rate);
+        float setSampleRate(const ulong& hz);
 
         /**
-         * Calls the passed function when the specified button is pressed.
+         * Compile time version of setSampleRate. The timer values are calculated
+         * by the compiler, and unsupported rates fail to compile. When scanning
+         * several channels, pass the channel count as the second parameter.
          * 
-         * - Usable in setup: true
-         * - Usable in loop: false
+         * Example Code:
          * 
-         * @param button Which button to map the passed function to.
-         * @param interval Delay between each button press to accept input.
-         * @param callback Function to call when button is pressed.
+         *     board.setSampleRate<5000>();
+         *     board.setSampleRate<2000, 4>(); // 4 channels at 2000 samples/second each
          * 
-         * @return void.
+         * - Usable in setup: true
+         * - Usable in loop: true
+         * 
+         * @return float - Rate actually achieved by the timer, 0 if the notch filter can't follow.
         **/
-        void enableButtonPress(const uint8_t& button, const int& interval, void (*callback)(void));
+        template <ulong HZ, uint8_t CHANNELS = 1>
+        float setSampleRate(void) {
+            typedef SampleRate<HZ, CHANNELS> Rate;
+            return this->applySampleRate(Rate::prescaler, Rate::top) ? Rate::achieved : 0;
+        }
 
         /**
-         * Calls the passed function when the specified button is pressed.
+         * Returns the rate the timer is currently sampling at.
          * 
          * - Usable in setup: true
-         * - Usable in loop: false
+         * - Usable in loop: true
          * 
-         * @param button Which button to map the passed function to.
-         * @param callback Function to call when button is pressed.
+         * @return float - Samples per second.
         **/
-        void enableButtonPress(const uint8_t& button, void (*callback)(void));
+        float getSampleRate(void);
 
         /**
-         * Calls a function when a button is pressed for a long time.
+         * Selects how the background sampling reads the ADC.
+         * 
+         * BLOCKING_SAMPLING calls analogRead() inside the timer interrupt, which
+         * waits for the whole conversion with interrupts off. ASYNC_SAMPLING only
+         * starts the conversion from the timer interrupt and collects the result
+         * in a short ADC interrupt, so the CPU is free during the conversion.
+         * 
+         * While ASYNC_SAMPLING is active, analogRead() must not be called by the sketch.
          * 
          * - Usable in setup: true
-         * - Usable in loop: false
+         * - Usable in loop: true
          * 
-         * @param button Which button to map the passed function to.
-         * @param milliseconds How many milliseconds the user should hold button for to execute function.
-         * @param callback Function to call when button is held for X milliseconds.
+         * @param mode Either BLOCKING_SAMPLING or ASYNC_SAMPLING.
          * 
          * @return void.
         **/
-        void enableButtonLongPress(const uint8_t& button, const int& milliseconds, void (*callback)(void));
+        void setSamplingMode(const int& mode);
 
         /**
-         * Calls the passed function when the envelope value is greater 
-         * than the passed threshold.
+         * Returns how many CPU cycles the interrupts spent on the last sample.
+         * In ASYNC_SAMPLING mode this is the timer interrupt plus the ADC interrupt.
+         * It covers all the work done per tick: triggers, buttons, relay, servo
+         * and ISR_STREAMING serial writes.
          * 
          * - Usable in setup: false
-         * - Usable in loop: false
-         * 
-         * @param threshold Threshold for envelope value.
-         * @param secondFactor Optional parameter for the second threshold the data must pass.
-         * @param callback Function to call when threshold is reached.
+         * - Usable in loop: true
          * 
-         * @return void.
+         * @return uint16_t - Cycles spent handling the last sample.
         **/
-        void setTriggerOnEnvelope(const int& threshold, const int& secondFactor, void (*callback)(void));
+        uint16_t getISRCycles(void);
 
         /**
-         * Calls the passed function when the envelope value is greater
-         * than the passed threshold.
+         * Returns counters describing the background sampling: samples produced and
+         * consumed, overruns (loop() too slow, samples overwritten), underruns
+         * (getNewSample called with nothing new), ISR cost and the sequence number
+         * of the newest tick.
          * 
-         * - Usable in setup: false
-         * - Usable in loop: false
+         * Overruns with a clean ISR cost point at a slow loop(). A high or growing
+         * maxISRCycles points at the sampling itself.
          * 
-         * @param threshold Threshold for envelope value.
-         * @param callback Function to call when threshold is reached.
+         * - Usable in setup: false
+         * - Usable in loop: true
          * 
-         * @return void.
+         * @return AcquisitionStats - Copy of the counters.
         **/
-        void setTriggerOnEnvelope(const int& threshold, void (*callback)(void));
+        AcquisitionStats getStats(void);
 
         /**
-         * Sets a flag to display the current strength of the readings using the
-         * LED bar.
+         * Restarts all counters returned by getStats, except the sequence number.
          * 
-         * - Usable in setup: false
+         * - Usable in setup: true
          * - Usable in loop: true
          * 
          * @return void.
         **/
-        void displayEMGStrength(void);
-
-        /* ******************************************************* */
-        /** @author Stanislav Mircic **/
+        void resetStats(void);
+
+        /**
+         * Returns the last measured sample from the channel.
+         * 
+         * - Usable in setup: false
+         * - Usable in loop: true
+         * 
+         * @return int - Last measured sample.
+        **/
+        int getNewSample(void);
+
+        /**
+         * Returns the last measured sample from one of the scanned channels.
+         * See setChannels.
+         * 
+         * - Usable in setup: false
+         * - Usable in loop: true
+         * 
+         * @param channel A0 - A5 (or 0 - 5), must be one of the scanned channels.
+         * 
+         * @return int - Last measured sample, 0 if the channel isn't scanned.
+        **/
+        int getNewSample(const uint8_t& channel);
+
+        /**
+         * Copies the samples waiting in the buffer into the passed array, oldest
+         * first, and returns how many were copied. Nothing is allocated, and the
+         * whole copy happens in one short critical section. Returns 0 when no
+         * new samples have arrived.
+         * 
+         * - Usable in setup: false
+         * - Usable in loop: true
+         * 
+         * Example Code:
+         * 
+         * int16_t samples[BUFFER_SIZE];
+         * 
+         * void loop() {
+         * 
+         *     uint16_t lost;
+         *     size_t count = board.readSamples(samples, BUFFER_SIZE, &lost);
+         *     for (size_t i = 0; i < count; i++) {
+         *         Serial.println(samples[i]);
+         *     }
+         * 
+         * }
+         * 
+         * @param dst Array to copy samples into.
+         * @param max Size of dst, most samples to copy.
+         * @param lost Optional, set to the number of samples overwritten before
+         *             they were read since the last call.
+         * 
+         * @return size_t - Number of samples copied into dst.
+        **/
+        size_t readSamples(int16_t* dst, const size_t& max, uint16_t* lost = nullptr);
+
+        /**
+         * Same as readSamples above, for one of the scanned channels. See setChannels.
+         * 
+         * - Usable in setup: false
+         * - Usable in loop: true
+         * 
+         * @param channel A0 - A5 (or 0 - 5), must be one of the scanned channels.
+         * @param dst Array to copy samples into.
+         * @param max Size of dst, most samples to copy.
+         * @param lost Optional, set to the number of samples lost to overrun.
+         * 
+         * @return size_t - Number of samples copied into dst, 0 if the channel isn't scanned.
+        **/
+        size_t readSamples(const uint8_t& channel, int16_t* dst, const size_t& max, uint16_t* lost = nullptr);
+
+        /**
+         * Gives direct access to the samples waiting in the buffer, without copying.
+         * The samples are split over at most two spans (pointer + length) because
+         * the buffer wraps around. They stay in the buffer until commitSamples()
+         * is called, so a whole block can be processed in place.
+         * 
+         * If loop() falls so far behind that the buffer fills while a block is being
+         * processed, the newest samples overwrite it. commitSamples() reports how many.
+         * 
+         * - Usable in setup: false
+         * - Usable in loop: true
+         * 
+         * Example Code:
+         * 
+         * void loop() {
+         * 
+         *     SampleSpan spans[2];
+         *     uint8_t count = board.peekSamples(spans);
+         *     for (uint8_t s = 0; s < 2; s++) {
+         *         Serial.write((const uint8_t*)spans[s].data, spans[s].length * sizeof(int16_t));
+         *     }
+         *     board.commitSamples(count);
+         * 
+         * }
+         * 
+         * @param spans Array of two spans to fill in.
+         * 
+         * @return uint8_t - Total number of samples in both spans.
+        **/
+        uint8_t peekSamples(SampleSpan spans[2]);
+
+        /**
+         * Same as peekSamples above, for one of the scanned channels. See setChannels.
+         * 
+         * @param channel A0 - A5 (or 0 - 5), must be one of the scanned channels.
+         * @param spans Array of two spans to fill in.
+         * 
+         * @return uint8_t - Total number of samples in both spans, 0 if the channel isn't scanned.
+        **/
+        uint8_t peekSamples(const uint8_t& channel, SampleSpan spans[2]);
+
+        /**
+         * Removes samples returned by the last peekSamples() from the buffer.
+         * 
+         * - Usable in setup: false
+         * - Usable in loop: true
+         * 
+         * @param count Number of samples processed, at most what peekSamples() returned.
+         * 
+         * @return uint8_t - Number of those samples that were overwritten while being processed.
+        **/
+        uint8_t commitSamples(const uint8_t& count);
+
+        /**
+         * Same as commitSamples above, for one of the scanned channels.
+         * 
+         * @param channel A0 - A5 (or 0 - 5), must be the channel passed to peekSamples.
+         * @param count Number of samples processed.
+         * 
+         * @return uint8_t - Number of those samples that were overwritten while being processed.
+        **/
+        uint8_t commitSamples(const uint8_t& channel, const uint8_t& count);
+
+		/**
+		 * Returns "size" samples to the passed array.
+		 * 
+		 * Deprecated: allocates a new array on every call. Use readSamples instead.
+		 * 
+		 * - Usable in setup: false
+		 * - Usable in loop: true
+		 * 
+		 * @param arr Array to modify.
+		 * @param size Number of samples to add (should be same size as arr).
+		 * 
+		 * @return void.
+		**/
+		void getSamples(int* arr[], const int& size) __attribute__((deprecated("use readSamples() instead")));
+
+        /**
+         * Returns the envelope value of the channel.
+         * 
+         * For every incoming reading from the analog, if that reading isn't bigger
+         * than the current envelope value, the envelope value is subtracted by one.
+         * This ensures we don't have an envelope value higher than necessary.
+         * See setEnvelopeEngine for other ways of calculating it.
+         * 
+         * - Usable in setup: false
+         * - Usable in loop: true
+         * 
+         * @return int - Envelope value.
+        **/
+        int getEnvelopeValue(void);
+
+        /**
+         * Returns the envelope value of one of the scanned channels.
+         * See setChannels.
+         * 
+         * - Usable in setup: false
+         * - Usable in loop: true
+         * 
+         * @param channel A0 - A5 (or 0 - 5), must be one of the scanned channels.
+         * 
+         * @return int - Envelope value, 0 if the channel isn't scanned.
+        **/
+        int getEnvelopeValue(const uint8_t& channel);
+
+        /**
+         * Removes mains hum (50 Hz or 60 Hz) from every sample before the envelope
+         * is calculated and the sample is buffered, so hum can't push the envelope
+         * over a trigger threshold. The notch is a fixed point biquad, NOTCH_BANDWIDTH
+         * Hz wide, with coefficients scaled to the sample rate (see BiquadCoefficients).
+         * It needs a sample rate above 2 * (mains + NOTCH_BANDWIDTH), lower rates are refused.
+         * 
+         * NOTCH_AUTO samples for NOTCH_CALIBRATION_MS without filtering, measures
+         * both mains frequencies and then notches the stronger one. The choice is
+         * made in handleInputs or getMainsFrequency, whichever is called first.
+         * 
+         * Coefficients follow setSampleRate, so the order of the two calls doesn't matter,
+         * except that setSampleRate refuses rates the notch can't run at while it is on.
+         * 
+         * - Usable in setup: true
+         * - Usable in loop: true
+         * 
+         * @param mains 50, 60, NOTCH_AUTO or NOTCH_OFF.
+         * 
+         * @return bool - False if the notch can't run at the current sample rate.
+        **/
+        bool setNotchFilter(const int& mains);
+
+        /**
+         * Compile time version of setNotchFilter. The coefficients are calculated
+         * by the compiler for the sample rate HZ, which must be the rate passed
+         * to setSampleRate<HZ>().
+         * 
+         * Example Code:
+         * 
+         *     board.setSampleRate<5000>();
+         *     board.setNotchFilter<50, 5000>();
+         * 
+         * - Usable in setup: true
+         * - Usable in loop: true
+         * 
+         * @return void.
+        **/
+        template <uint8_t MAINS, ulong HZ>
+        void setNotchFilter(void) {
+            this->applyNotchFilter(MAINS, NotchFilter<MAINS, HZ>::coefficients);
+        }
+
+        /**
+         * Returns the mains frequency being filtered.
+         * 
+         * - Usable in setup: true
+         * - Usable in loop: true
+         * 
+         * @return int - 50 or 60, 0 if the notch is off or still calibrating.
+        **/
+        int getMainsFrequency(void);
+
+        /**
+         * Runs every sample through the passed function in the sample interrupt,
+         * after the notch filter and before the envelope, buffers and streaming.
+         * Results are clamped to 0 - ADC_MAX. Filter chains from NeuroDSP.hpp
+         * are installed with runChain, which keeps the whole chain in one function.
+         * 
+         * Example Code:
+         * 
+         *     typedef Chain<HighPass<5000, 20>, Rectify<>, LowPass<5000, 10>> EmgChain;
+         * 
+         *     board.setSampleRate<5000>();
+         *     board.setSampleFilter(runChain<EmgChain>);
+         * 
+         * - Usable in setup: true
+         * - Usable in loop: true
+         * 
+         * @param filter Function taking the scan slot (0 is the first channel) and
+         *               the sample, returning the filtered sample. nullptr removes it.
+         * 
+         * @return void.
+        **/
+        void setSampleFilter(int16_t (*filter)(uint8_t slot, int16_t sample));
+
+        /**
+         * Produces a second, slower stream of samples from the first scanned channel,
+         * for consumers like the servo, LED bar or serial printing that don't need
+         * the full sample rate. Samples are filtered by a CIC decimator
+         * (see NeuroDSP.hpp) before being thinned out, so fast signals don't alias
+         * into the slow stream. Read them with getNewDecimatedSample.
+         * 
+         * Example Code:
+         * 
+         *     board.setSampleRate<4000>();
+         *     board.setDecimation(32); // 125 samples per second
+         * 
+         * - Usable in setup: true
+         * - Usable in loop: true
+         * 
+         * @param factor Samples per decimated sample, a power of two up to MAX_DECIMATION.
+         *               0 turns decimation off.
+         * 
+         * @return bool - False if the factor isn't supported.
+        **/
+        bool setDecimation(const uint8_t& factor);
+
+        /**
+         * Returns the next decimated sample. See setDecimation.
+         * 
+         * - Usable in setup: false
+         * - Usable in loop: true
+         * 
+         * @return int - Oldest unread decimated sample, or the last one again if none is new.
+        **/
+        int getNewDecimatedSample(void);
+
+        /**
+         * Returns how many decimated samples are produced per second.
+         * 
+         * - Usable in setup: true
+         * - Usable in loop: true
+         * 
+         * @return float - Sample rate divided by the decimation factor, 0 if off.
+        **/
+        float getDecimatedRate(void);
+
+        /**
+         * Keeps statistics over the newest samples of the channel as they arrive,
+         * so getWindowMean, getWindowRMS and getWindowMinMax cost the same no matter
+         * how big the window is, and don't take samples out of the buffer.
+         * Only the first scanned channel is tracked. The window starts empty.
+         * 
+         * Example Code:
+         * 
+         *     board.setWindowSize(10);                 // In setup
+         *     int finalReading = board.getWindowMean(); // In loop
+         * 
+         * - Usable in setup: true
+         * - Usable in loop: true
+         * 
+         * @param samples Samples in the window, 1 to WINDOW_MAX_SIZE. 0 turns the statistics off.
+         * 
+         * @return bool - False if samples is larger than WINDOW_MAX_SIZE.
+        **/
+        bool setWindowSize(const uint8_t& samples);
+
+        /**
+         * Returns the average of the samples in the window. See setWindowSize.
+         * 
+         * - Usable in setup: false
+         * - Usable in loop: true
+         * 
+         * @return int - Mean of the window, 0 while it is empty.
+        **/
+        int getWindowMean(void);
+
+        /**
+         * Returns the root mean square of the samples in the window. See setWindowSize.
+         * 
+         * - Usable in setup: false
+         * - Usable in loop: true
+         * 
+         * @return int - RMS of the window, 0 while it is empty.
+        **/
+        int getWindowRMS(void);
+
+        /**
+         * Returns the smallest and largest samples in the window. See setWindowSize.
+         * 
+         * - Usable in setup: false
+         * - Usable in loop: true
+         * 
+         * @param min Set to the smallest sample.
+         * @param max Set to the largest sample.
+         * 
+         * @return bool - False if the window is empty, min and max are left untouched.
+        **/
+        bool getWindowMinMax(int& min, int& max);
+
+        /**
+         * Sets the current channel to listen on. Works with A0, A1, A2 etc.
+		 * 
+         * Boundries for built in analogs:
+         *      setChannel(n) where:
+         *          A0 <= n <= A5
+         * 
+         * - Usable in setup: true
+         * - Usable in loop: true
+         * 
+         * @param uint8_t Channel.
+         * 
+         * @return void.
+        **/
+        void setChannel(const uint8_t& channel);
+
+        /**
+         * Samples several channels every tick, one after another. Each channel gets
+         * its own buffer and envelope value, read with getNewSample(channel) and
+         * getEnvelopeValue(channel). The first channel is used by the envelope
+         * trigger, servo and EMG strength display.
+         * 
+         * Example Code:
+         * 
+         *     uint8_t muscles[] = {A0, A1, A2, A3};
+         *     board.setChannels(muscles, 4);
+         * 
+         * - Usable in setup: true
+         * - Usable in loop: true
+         * 
+         * @param channels Array of channels, A0 - A5 (or 0 - 5).
+         * @param count Number of channels in the array, 1 to MAX_CHANNELS.
+         * 
+         * @return bool - False if the count is invalid or the ADC can't convert
+         *                that many channels at the current sample rate.
+        **/
+        bool setChannels(const uint8_t channels[], const uint8_t& count);
+
+        /**
+         * Returns how many samples each channel's buffer holds before the oldest
+         * are overwritten.
+         * 
+         * - Usable in setup: true
+         * - Usable in loop: true
+         * 
+         * @return uint8_t - Samples per channel.
+        **/
+        uint8_t getBufferDepth(void);
+
+        /**
+         * Selects how the envelope value is calculated. Every engine runs in the
+         * sample interrupt using integer shifts, and time constants are given in
+         * milliseconds so they don't change with setSampleRate.
+         * 
+         * PEAK_DECAY_ENVELOPE: Default. Follows peaks, drops by the decay rate every
+         *                      sample (see setDecayRate). Ignores milliseconds.
+         * PEAK_HOLD_ENVELOPE:  Follows peaks, then falls to about a third within milliseconds.
+         * LOWPASS_ENVELOPE:    Distance from zeroLevel, smoothed over milliseconds.
+         *                      Single sample spikes barely move it.
+         * RMS_ENVELOPE:        Root mean square distance from zeroLevel over about
+         *                      milliseconds, updated every RMS_UPDATE_INTERVAL samples.
+         * 
+         * Time constants are rounded to a power of two samples. Use a zeroLevel of 0
+         * for signals that are already an envelope (the Muscle SpikerShield output),
+         * or the resting level (around 512) for raw signals centered mid scale.
+         * 
+         * - Usable in setup: true
+         * - Usable in loop: true
+         * 
+         * @param engine PEAK_DECAY_ENVELOPE, PEAK_HOLD_ENVELOPE, LOWPASS_ENVELOPE or RMS_ENVELOPE.
+         * @param milliseconds Time constant of the engine.
+         * @param zeroLevel Reading that counts as no signal, LOWPASS_ENVELOPE and RMS_ENVELOPE only.
+         * 
+         * @return void.
+        **/
+        void setEnvelopeEngine(const int& engine, const uint16_t& milliseconds = 100, const int& zeroLevel = 0);
+
+        /**
+         * Sets the decay rate for the setTriggerOnEnvelope function.
+         * I.E, setDecayRate(5) will subtract envelopeValue by 5 every tick.
+         * 
+         * - Usable in setup: true
+         * - Usable in loop: true
+         * 
+         * @param rate Integer representing the scale at which envelopeValue will be subtracted.
+         * 
+         * @return void.
+        **/
+        void setDecayRate(const int& rate);
+
+        /**
+         * Calls the passed function when the specified button is pressed.
+         * 
+         * - Usable in setup: true
+         * - Usable in loop: false
+         * 
+         * @param button Which button to map the passed function to.
+         * @param interval Delay between each button press to accept input.
+         * @param callback Function to call when button is pressed.
+         * 
+         * @return void.
+        **/
+        void enableButtonPress(const uint8_t& button, const int& interval, void (*callback)(void));
+
+        /**
+         * Calls the passed function when the specified button is pressed.
+         * 
+         * Button edges are caught by interrupts (INT6 for WHITE_BTN, the sample
+         * timer for RED_BTN, whose pin has no interrupt) and timestamped there,
+         * so presses are never missed by a slow loop(). A press is a release
+         * within SHORT_PRESS_MS of pushing the button.
+         * 
+         * - Usable in setup: true
+         * - Usable in loop: false
+         * 
+         * @param button Which button to map the passed function to.
+         * @param callback Function to call when button is pressed.
+        **/
+        void enableButtonPress(const uint8_t& button, void (*callback)(void));
+
+        /**
+         * Adds a button gesture. Every gesture is recognized from the same per
+         * button state, by one pass over the gesture table in handleInputs.
+         * 
+         * PRESS_GESTURE:       A press (released within SHORT_PRESS_MS). With both
+         *                      buttons, a chord: called as soon as both are down.
+         * MULTI_PRESS_GESTURE: value presses of one button, each within DOUBLE_PRESS_MS
+         *                      of the last. Single presses wait out that gap once a
+         *                      button has multi press gestures.
+         * LONG_PRESS_GESTURE:  Called once the buttons are held for value ms.
+         * HOLD_REPEAT_GESTURE: Called on press, then every value ms once held for
+         *                      HOLD_REPEAT_DELAY_MS, like a key repeating.
+         * 
+         * A press used by a long press, hold repeat or chord isn't also reported as a press.
+         * A hold repeat fires as soon as its buttons are down, so press, multi press and
+         * long press gestures on the same buttons never fire; give it buttons of its own.
+         * Chords that include its buttons still fire, alongside the repeats.
+         * 
+         * Example Code:
+         * 
+         *     board.addGesture(RED_BTN_MASK, HOLD_REPEAT_GESTURE, 100, increaseLevel);
+         *     board.addGesture(WHITE_BTN_MASK, MULTI_PRESS_GESTURE, 3, nextMode);
+         *     board.addGesture(RED_BTN_MASK | WHITE_BTN_MASK, LONG_PRESS_GESTURE, 2000, reset);
+         * 
+         * - Usable in setup: true
+         * - Usable in loop: false
+         * 
+         * @param buttons RED_BTN_MASK, WHITE_BTN_MASK, or both for a chord.
+         * @param gesture PRESS_GESTURE, MULTI_PRESS_GESTURE, LONG_PRESS_GESTURE or HOLD_REPEAT_GESTURE.
+         * @param value Press count, hold milliseconds or repeat milliseconds. Ignored for PRESS_GESTURE.
+         * @param callback Function to call when the gesture is recognized.
+         * 
+         * @return bool - False if the table is full or the gesture isn't supported.
+        **/
+        bool addGesture(const uint8_t& buttons, const uint8_t& gesture, const uint16_t& value, void (*callback)(void));
+
+        /**
+         * Calls the passed function when the specified button is pressed twice
+         * within DOUBLE_PRESS_MS. Once enabled, a single press of that button is
+         * only reported after DOUBLE_PRESS_MS has passed without a second one.
+         * 
+         * - Usable in setup: true
+         * - Usable in loop: false
+         * 
+         * @param button Which button to map the passed function to.
+         * @param callback Function to call when button is double pressed.
+         * 
+         * @return void.
+        **/
+        void enableButtonDoublePress(const uint8_t& button, void (*callback)(void));
+
+        /**
+         * Calls a function when a button is pressed for a long time.
+         * 
+         * - Usable in setup: true
+         * - Usable in loop: false
+         * 
+         * @param button Which button to map the passed function to.
+         * @param milliseconds How many milliseconds the user should hold button for to execute function.
+         * @param callback Function to call when button is held for X milliseconds.
+         * 
+         * @return void.
+        **/
+        void enableButtonLongPress(const uint8_t& button, const int& milliseconds, void (*callback)(void));
+
+        /**
+         * Adds a trigger that calls the passed function when the envelope value of
+         * a channel crosses a threshold. Up to MAX_TRIGGERS triggers are checked
+         * together on every tick of the sample interrupt, so several force levels
+         * can drive different outputs. Crossings are queued with a timestamp and
+         * the callbacks are called from handleInputs, see getLastTriggerEvent.
+         * 
+         * RISING_EDGE fires once the envelope reaches threshold, and rearms once it
+         * has dropped to threshold - hysteresis. FALLING_EDGE fires once the envelope
+         * drops to threshold, and rearms once it is back up to threshold + hysteresis.
+         * 
+         * Example Code:
+         * 
+         *     board.addTrigger(A0, 300, 50, RISING_EDGE, lightGrip);
+         *     board.addTrigger(A0, 600, 50, RISING_EDGE, mediumGrip);
+         *     board.addTrigger(A0, 900, 50, RISING_EDGE, strongGrip, true);
+         * 
+         * - Usable in setup: true
+         * - Usable in loop: true
+         * 
+         * @param channel A0 - A5 (or 0 - 5), or PRIMARY_CHANNEL for the first scanned channel.
+         * @param threshold Envelope value that fires the trigger.
+         * @param hysteresis How far back past threshold the envelope must go to rearm.
+         * @param edge RISING_EDGE or FALLING_EDGE.
+         * @param callback Function to call when the trigger fires, nullptr for a trigger that only drives the relay.
+         * @param relay Whether to start the relay pulse train when the trigger fires, see setRelayPulse.
+         * 
+         * @return int8_t - Trigger id for removeTrigger, -1 if MAX_TRIGGERS are in use.
+        **/
+        int8_t addTrigger(const uint8_t& channel, const int& threshold, const int& hysteresis, const uint8_t& edge, void (*callback)(void), const bool& relay = false);
+
+        /**
+         * Returns the trigger event whose callback was called last. Call it from
+         * the callback to find out when the threshold was actually crossed:
+         * micros() - getLastTriggerEvent().micros is how long the callback was
+         * delayed by loop(), and sequence / getSampleRate() locates the crossing
+         * in the sample stream.
+         * 
+         * - Usable in setup: false
+         * - Usable in loop: true
+         * 
+         * @return TriggerEvent - Copy of the event, all zero if no trigger has fired yet.
+        **/
+        TriggerEvent getLastTriggerEvent(void);
+
+        /**
+         * Removes a trigger added with addTrigger or setTriggerOnEnvelope. Crossings
+         * it already queued are dropped, also once its id is handed out again.
+         * 
+         * - Usable in setup: true
+         * - Usable in loop: true
+         * 
+         * @param id Trigger id returned when it was added.
+         * 
+         * @return void.
+        **/
+        void removeTrigger(const int8_t& id);
+
+        /**
+         * Calls the passed function when the envelope value is greater 
+         * than the passed threshold. Adds a rising edge trigger on the first
+         * scanned channel that pulses the relay, see addTrigger.
+         * 
+         * - Usable in setup: false
+         * - Usable in loop: false
+         * 
+         * @param threshold Threshold for envelope value.
+         * @param secondFactor Optional parameter for the second threshold the data must pass.
+         * @param callback Function to call when threshold is reached.
+         * 
+         * @return int8_t - Trigger id for removeTrigger, -1 if MAX_TRIGGERS are in use.
+        **/
+        int8_t setTriggerOnEnvelope(const int& threshold, const int& secondFactor, void (*callback)(void));
+
+        /**
+         * Calls the passed function when the envelope value is greater
+         * than the passed threshold.
+         * 
+         * - Usable in setup: false
+         * - Usable in loop: false
+         * 
+         * @param threshold Threshold for envelope value.
+         * @param callback Function to call when threshold is reached.
+         * 
+         * @return int8_t - Trigger id for removeTrigger, -1 if MAX_TRIGGERS are in use.
+        **/
+        int8_t setTriggerOnEnvelope(const int& threshold, void (*callback)(void));
+
+        /**
+         * Sets the shape of the relay pulse train started by pulseRelay and by
+         * triggers added with relay set. The pulses are timed by the sample
+         * interrupt, so times are rounded to whole sample ticks, at least one,
+         * and follow setSampleRate.
+         * 
+         * At the DEFAULT_SAMPLE_RATE of 250 samples/second a tick is 4ms, so the
+         * default RELAY_PULSE_US pulse comes out 4ms long, where the delay(1) of
+         * earlier versions gave 1ms. Sample at 1000 samples/second or more for
+         * 1ms pulses. The return value is the width actually produced.
+         * 
+         * Example Code (TENS burst of 5 pulses of 200us, 20ms apart, at 5000
+         * samples/second for 200us steps):
+         * 
+         *     board.setSampleRate(5000);
+         *     board.setRelayPulse(200, 5, 20000);
+         * 
+         * - Usable in setup: true
+         * - Usable in loop: true
+         * 
+         * @param widthMicros How long the relay stays on for each pulse.
+         * @param count Pulses in the train, or CONTINUOUS_PULSES to repeat until stopRelay.
+         * @param intervalMicros How long the relay stays off between pulses, at least one tick.
+         * 
+         * @return ulong - Pulse width actually produced in microseconds, 0 if widthMicros is 0.
+        **/
+        ulong setRelayPulse(const ulong& widthMicros, const uint8_t& count = 1, const ulong& intervalMicros = 0);
+
+        /**
+         * Starts the pulse train set with setRelayPulse and returns right away.
+         * The first pulse starts on the next sample tick.
+         * 
+         * - Usable in setup: false
+         * - Usable in loop: true
+         * 
+         * @return bool - False if a train is already running or measurements haven't started.
+        **/
+        bool pulseRelay(void);
+
+        /**
+         * Stops the pulse train and turns the relay off.
+         * 
+         * - Usable in setup: true
+         * - Usable in loop: true
+         * 
+         * @return void.
+        **/
+        void stopRelay(void);
+
+        /**
+         * Returns whether a relay pulse train is running.
+         * 
+         * - Usable in setup: false
+         * - Usable in loop: true
+         * 
+         * @return bool.
+        **/
+        bool isRelayPulsing(void);
+
+        /**
+         * Sets a flag to display the current strength of the readings using the
+         * LED bar.
+         * 
+         * - Usable in setup: false
+         * - Usable in loop: true
+         * 
+         * @return void.
+        **/
+        void displayEMGStrength(void);
+
+        /* ******************************************************* */
+        /** @author Stanislav Mircic **/
 
         void writeLED(const int& led, const bool& state);
 
         /* ******************************************************* */
 
+        /**
+         * Lights the first height LEDs of the LED bar and turns the others off.
+         * The whole bar is shifted out in one transfer, and not at all if it
+         * already shows that height. Prefer it to one writeLED per LED, which
+         * shifts out the whole bar every call.
+         * 
+         * - Usable in setup: true
+         * - Usable in loop: true
+         * 
+         * @param height LEDs to light, 0 to MAX_LEDS.
+         * 
+         * @return void.
+        **/
+        void writeLEDBar(const uint8_t& height);
+
+    protected:
+
+        /**
+         * Creates a board whose sample buffers live in the passed storage.
+         * Used by BufferedNeuroBoard.
+         * 
+         * @param storage Array of depth * channels samples.
+         * @param depth Samples per channel, power of two.
+         * @param channels Most channels that can be scanned at once.
+        **/
+        NeuroBoard(int16_t* storage, const uint8_t& depth, const uint8_t& channels);
+
     private:
 
+        int16_t* sampleStorage;
+        uint8_t bufferDepth;
+        uint8_t bufferChannels;
+
+        bool applySampleRate(const uint16_t& prescaler, const uint16_t& top);
+        void applyNotchFilter(const uint8_t& mains, const BiquadCoefficients& coefficients);
+
         /* ******************************************************* */
         /** @author Stanislav Mircic **/
 
@@ -437,6 +1570,75 @@ class NeuroBoard {
 
 };
 
+// Sample RAM Budget //
+
+#if defined(RAMEND) && defined(RAMSTART)
+    #define DEVICE_RAM          (RAMEND - RAMSTART + 1) // 2560 bytes on the ATmega32U4
+#else
+    #define DEVICE_RAM          2560
+#endif
+
+#if TX_BUFFER_SIZE > 0
+    #define TX_BUFFER_RAM   sizeof(StaticRingBuffer<uint8_t, TX_BUFFER_SIZE, DROP_NEWEST>)
+#else
+    #define TX_BUFFER_RAM   0
+#endif
+
+/**
+ * RAM the library takes whatever the sketch uses: its queues, filter state
+ * and tables. Sample storage comes on top of this.
+**/
+#define LIBRARY_STATIC_RAM ( \
+    TX_BUFFER_RAM + \
+    sizeof(StaticRingBuffer<int16_t, DECIMATED_BUFFER_SIZE, SAMPLE_OVERRUN_POLICY>) + \
+    sizeof(StaticRingBuffer<TriggerEvent, TRIGGER_QUEUE_SIZE, DROP_NEWEST>) + \
+    sizeof(StaticRingBuffer<ButtonEvent, BUTTON_QUEUE_SIZE, DROP_NEWEST>) + \
+    sizeof(SlidingWindow<WINDOW_MAX_SIZE>) + \
+    sizeof(CicDecimator<CIC_ORDER>) + \
+    MAX_TRIGGERS * sizeof(Trigger) + \
+    MAX_GESTURES * sizeof(Gesture) + \
+    BUTTON_COUNT * sizeof(ButtonState) + \
+    MAX_CHANNELS * (sizeof(RingBuffer<int16_t, SAMPLE_OVERRUN_POLICY>) + sizeof(Biquad) + sizeof(int32_t) + sizeof(int)) + \
+    sizeof(NeuroServo) + sizeof(AcquisitionStats) + sizeof(StreamStats) + sizeof(ServoStats) + \
+    3 * sizeof(MapKernel))   // The larger SERVO_MAPPING backend, the sketch can't tell which the library has
+
+/**
+ * Most RAM (bytes) sample buffers may take: the part's RAM, less what the
+ * library always takes and SKETCH_RAM_RESERVE.
+**/
+#define SAMPLE_RAM_BUDGET   ((long)DEVICE_RAM - (long)LIBRARY_STATIC_RAM - SKETCH_RAM_RESERVE)
+
+/**
+ * NeuroBoard with compile time buffer sizes. Each sketch can trade RAM for
+ * how long loop() may go without reading samples before they are overwritten.
+ * Sizes that don't fit SAMPLE_RAM_BUDGET fail to compile.
+ * 
+ * Example Code:
+ * 
+ *     BufferedNeuroBoard<128, 1> board; // One channel, 128 samples (~25 ms at 5000 samples/second)
+ *     BufferedNeuroBoard<16, 4> board;  // Four channels, 16 samples each
+ * 
+ * @param DEPTH Samples per channel, power of two up to RING_BUFFER_MAX_SIZE.
+ * @param CHANNELS Most channels that can be passed to setChannels.
+**/
+template <uint8_t DEPTH, uint8_t CHANNELS = MAX_CHANNELS>
+class BufferedNeuroBoard : public NeuroBoard {
+
+    static_assert(DEPTH > 0 && (DEPTH & (DEPTH - 1)) == 0, "Buffer depth must be a power of two");
+    static_assert(DEPTH <= RING_BUFFER_MAX_SIZE, "Buffer depth must fit single byte indices");
+    static_assert(CHANNELS >= 1 && CHANNELS <= MAX_CHANNELS, "Channel count must be between 1 and MAX_CHANNELS");
+    static_assert((long)DEPTH * CHANNELS * sizeof(int16_t) <= SAMPLE_RAM_BUDGET, "Sample buffers exceed SAMPLE_RAM_BUDGET");
+
+    public:
+
+        BufferedNeuroBoard() : NeuroBoard(storage, DEPTH, CHANNELS) {};
+
+    private:
+
+        int16_t storage[DEPTH * CHANNELS];
+
+};
+
 /**
  * Custom delay function so our code can continue to run while the 
  * user wants to delay. This is non-blocking, so code will continue
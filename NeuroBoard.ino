@@ -54,12 +54,11 @@ void loop() {
 	Serial.println(sample);
 	delay(5);
 
-	//int* samples;
-	//board.getSamples(&samples, 10);
-	//for (int i = 0; i < 10; i++) {
+	//int16_t samples[10];
+	//size_t count = board.readSamples(samples, 10);
+	//for (size_t i = 0; i < count; i++) {
 	//	Serial.println(samples[i]);
 	//}
-	//delete[] samples; // Free memory for reallocation. REQUIRED.
 	//delay(2000);
 
 }
@@ -0,0 +1,928 @@
+/**
+    NeuroDSP.hpp - A library for interacting with the Neuroduino Board.
+    Copyright (C) 2021 Backyard Brains
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+    USA
+
+    Backyard Brains hereby disclaims all copyright interest in the library
+    `NeuroBoard` (a library for interacting with the Neuroduino Board) written
+    by Benjamin Antonellis.
+
+    Backyard Brains, March 2021.
+**/
+
+/**
+ * Fixed point signal processing used by the sample ISR.
+ *
+ * Everything here is integer only and avoids division, so it is cheap enough
+ * to run once per sample. Filter state is kept with 16 fractional bits
+ * (value << 16) so small steps aren't lost to rounding.
+**/
+
+#pragma once
+
+#ifndef NEURO_DSP_HPP
+#define NEURO_DSP_HPP
+
+#include <stdint.h>
+
+/**
+ * Shift k such that a single pole filter y += (x - y) >> k has a time constant
+ * of about the passed number of samples (k = round(log2(samples))).
+**/
+constexpr uint8_t timeConstantShift(const unsigned long samples, const uint8_t shift = 0) {
+    return (shift >= 15 || samples <= (3UL << shift) / 2) ? shift : timeConstantShift(samples, shift + 1);
+}
+
+/**
+ * timeConstantShift for a time constant given in milliseconds at a sample rate.
+**/
+constexpr uint8_t timeConstantShiftMs(const unsigned long milliseconds, const float rate) {
+    return timeConstantShift((unsigned long)(milliseconds * rate / 1000));
+}
+
+// Constant Expressions //
+
+constexpr float DSP_PI = 3.14159265f;
+
+/**
+ * Taylor series of cos, usable at compile time. x must be within -PI and PI.
+**/
+constexpr float dspCosSeries(const float x2, const float term, const float sum, const uint8_t n) {
+    return (n > 10) ? sum : dspCosSeries(x2, -term * x2 / ((2 * n - 1) * (2 * n)), sum - term * x2 / ((2 * n - 1) * (2 * n)), n + 1);
+}
+
+constexpr float dspCos(const float x) {
+    return dspCosSeries(x * x, 1, 1, 1);
+}
+
+/**
+ * 1 - cos(x), without the cancellation of subtracting cos(x) from 1 when x is small.
+**/
+constexpr float dspVersine(const float x) {
+    return -dspCosSeries(x * x, 1, 0, 1);
+}
+
+constexpr float dspAbs(const float x) {
+    return (x < 0) ? -x : x;
+}
+
+constexpr float dspMax(const float a, const float b) {
+    return (a > b) ? a : b;
+}
+
+/**
+ * Number of fractional bits (at most 26) that still fit largest in 16 bits.
+**/
+constexpr uint8_t fixedShift(const float largest, const uint8_t shift = 0) {
+    return (shift >= 26 || largest * (2UL << shift) > 32767) ? shift : fixedShift(largest, shift + 1);
+}
+
+/**
+ * Rounds to a fixed point value with shift fractional bits.
+**/
+constexpr int16_t toFixed(const float value, const uint8_t shift) {
+    return (int16_t)(value * (1UL << shift) + ((value >= 0) ? 0.5f : -0.5f));
+}
+
+/**
+ * Notch biquad coefficients. At high sample rates the usual coefficients sit
+ * right next to 1 and 2, where 16 bits can't place the notch or the poles
+ * precisely, so each one is stored as its distance from that integer:
+ * 
+ *     y = (1 + gain)(x - 2x1 + x2) + zero x1 + 2y1 - y2 - pole1 y1 + pole2 y2
+ * 
+ * which is gain (1 - 2cos(w) z^-1 + z^-2) / (1 - 2r cos(w) z^-1 + r^2 z^-2).
+ * The zeros stay exactly on the unit circle whatever the rounding. All four
+ * have shift fractional bits, picked per rate so the largest fills 16 bits.
+**/
+struct BiquadCoefficients {
+    int16_t gain;       // Gain - 1
+    int16_t zero;       // Gain * (2 - 2cos(w))
+    int16_t pole1;      // 2 - 2r cos(w)
+    int16_t pole2;      // 1 - r^2
+    uint8_t shift;
+};
+
+constexpr BiquadCoefficients notchFromShift(const float gain, const float zero, const float pole1, const float pole2, const uint8_t shift) {
+    return BiquadCoefficients{toFixed(gain, shift), toFixed(zero, shift), toFixed(pole1, shift), toFixed(pole2, shift), shift};
+}
+
+constexpr BiquadCoefficients notchFromTerms(const float gain, const float zero, const float pole1, const float pole2) {
+    return notchFromShift(gain, zero, pole1, pole2, fixedShift(dspMax(dspMax(dspAbs(gain), zero), dspMax(pole1, pole2))));
+}
+
+/**
+ * v is 1 - cos(w), q is 1 - r. The gain is (1 - 2r cos(w) + r^2) / (2 - 2cos(w))
+ * for a gain of 1 at DC, which works out to r + q^2 / 2v.
+**/
+constexpr BiquadCoefficients notchFromPoles(const float v, const float q) {
+    return notchFromTerms(q * q / (2 * v) - q, q * q + 2 * v * (1 - q), 2 * (q + v - q * v), q * (2 - q));
+}
+
+/**
+ * Notch at frequency, zeros on the unit circle and poles just inside it at
+ * radius 1 - PI * bandwidth / rate. Scaled for a gain of 1 at DC.
+**/
+constexpr BiquadCoefficients notchCoefficients(const float frequency, const float rate, const float bandwidth) {
+    return notchFromPoles(dspVersine(2 * DSP_PI * frequency / rate), DSP_PI * bandwidth / rate);
+}
+
+/**
+ * Whether a notch at frequency can run at rate: the notch has to sit below
+ * Nyquist, and the zero term needs enough bits to place it within a small
+ * fraction of the bandwidth.
+**/
+constexpr bool notchUsable(const float frequency, const float rate, const float bandwidth) {
+    return 2 * (frequency + bandwidth) < rate && notchCoefficients(frequency, rate, bandwidth).zero >= 256;
+}
+
+/**
+ * Legacy envelope: follows peaks, otherwise drops by a fixed amount per sample.
+**/
+inline int16_t peakDecay(const int16_t& x, const int16_t& envelope, const int16_t& rate) {
+    return (x >= envelope) ? x : (envelope - rate);
+}
+
+/**
+ * Peak hold with exponential decay. acc holds the envelope << 16 and loses
+ * 1 / 2^shift of itself every sample.
+**/
+inline int16_t peakHold(const int16_t& x, int32_t& acc, const uint8_t& shift) {
+    acc -= acc >> shift;
+    int32_t peak = (int32_t)x << 16;
+    if (peak > acc) acc = peak;
+    return acc >> 16;
+}
+
+/**
+ * Full wave rectification around zero followed by a single pole lowpass.
+ * acc holds the output << 16.
+**/
+inline int16_t rectifyLowpass(const int16_t& x, const int16_t& zero, int32_t& acc, const uint8_t& shift) {
+    int16_t rectified = (x >= zero) ? (x - zero) : (zero - x);
+    acc += (((int32_t)rectified << 16) - acc) >> shift;
+    return acc >> 16;
+}
+
+/**
+ * Exponentially weighted mean square around zero. acc holds the mean square << 8.
+ * The square is the only multiply, a 16 x 16 bit one.
+**/
+inline void meanSquare(const int16_t& x, const int16_t& zero, int32_t& acc, const uint8_t& shift) {
+    int16_t deviation = (x >= zero) ? (x - zero) : (zero - x);
+    int32_t square = (int32_t)((uint32_t)(uint16_t)deviation * (uint16_t)deviation) << 8;
+    acc += (square - acc) >> shift;
+}
+
+/**
+ * Integer square root, bit by bit (16 iterations of shifts and adds).
+**/
+inline uint16_t isqrt32(uint32_t value) {
+    uint32_t root = 0;
+    uint32_t bit = 1UL << 30;
+    while (bit > value) bit >>= 2;
+    while (bit) {
+        if (value >= root + bit) {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return root;
+}
+
+/**
+ * Arithmetic shift right by a shift only known at run time. Whole bytes go
+ * first, which AVR does with register moves instead of a bit at a time.
+**/
+inline int32_t shiftRight(int32_t value, uint8_t shift) {
+    if (shift >= 16) {
+        value >>= 16;
+        shift -= 16;
+    }
+    if (shift >= 8) {
+        value >>= 8;
+        shift -= 8;
+    }
+    return value >> shift;
+}
+
+/**
+ * Direct form I notch biquad, see BiquadCoefficients. The accumulator is 32
+ * bits and only holds the small terms, the integer part of the recursion is
+ * added separately. The fraction dropped from each output is kept (Q15) and
+ * fed back through the poles, so the recursion runs as if the outputs were
+ * never rounded; otherwise a narrow notch at a high sample rate amplifies the
+ * rounding noise far above the signal.
+**/
+class Biquad {
+
+    public:
+
+        Biquad() : x1(0), x2(0), y1(0), y2(0), fraction1(0), fraction2(0) {};
+
+        void clear(void) {
+            this->x1 = this->x2 = this->y1 = this->y2 = 0;
+            this->fraction1 = this->fraction2 = 0;
+        }
+
+        int16_t process(const int16_t& x, const BiquadCoefficients& k) {
+
+            int16_t difference = x - 2 * this->x1 + this->x2;
+            int32_t acc = (int32_t)k.gain * difference + (int32_t)k.zero * this->x1
+                        - (int32_t)k.pole1 * this->y1 + (int32_t)k.pole2 * this->y2
+                        + (((int32_t)k.pole2 * this->fraction2 - (int32_t)k.pole1 * this->fraction1) >> 15);
+
+            // From k.shift fractional bits to Q15, at most 4 coefficient bits are below 15 //
+
+            acc = (k.shift >= 15) ? shiftRight(acc, k.shift - 15) : acc * (1 << (15 - k.shift));
+            acc += 2 * (int32_t)this->fraction1 - this->fraction2;
+
+            int16_t y = difference + 2 * this->y1 - this->y2 + (int16_t)(acc >> 15);
+
+            this->x2 = this->x1;
+            this->x1 = x;
+            this->y2 = this->y1;
+            this->y1 = y;
+            this->fraction2 = this->fraction1;
+            this->fraction1 = acc & 0x7FFF;
+
+            return y;
+
+        }
+
+    private:
+
+        int16_t x1, x2, y1, y2;
+        int16_t fraction1, fraction2;   // Dropped from the last two outputs, Q15
+
+};
+
+/**
+ * (coefficient * value) >> 13 without a 64 bit multiply: two 16 x 16 bit
+ * products, one per half of value. Exact while value stays within 28 bits.
+**/
+inline int32_t multiplyQ13(const int16_t& coefficient, const int32_t& value) {
+    int32_t high = (int32_t)coefficient * (int16_t)(value >> 16);
+    int32_t low = (int32_t)coefficient * (int32_t)(uint16_t)value;
+    return high * 8 + (low >> 13);
+}
+
+/**
+ * Q13 Goertzel coefficient, 2 cos(w).
+**/
+constexpr int16_t goertzelCoefficient(const float frequency, const float rate) {
+    return (int16_t)(2 * dspCos(2 * DSP_PI * frequency / rate) * 8192 + 0.5f);
+}
+
+/**
+ * Goertzel detector, measures the power of one frequency over a block of samples.
+ * Feed it a signal without DC (a first difference, for instance), DC would
+ * otherwise build up in the state.
+**/
+class Goertzel {
+
+    public:
+
+        Goertzel() : coefficient(0), s1(0), s2(0) {};
+
+        void setFrequency(const float& frequency, const float& rate) {
+            this->coefficient = goertzelCoefficient(frequency, rate);
+            this->clear();
+        }
+
+        void clear(void) {
+            this->s1 = this->s2 = 0;
+        }
+
+        void push(const int16_t& sample) {
+            int32_t s = sample + multiplyQ13(this->coefficient, this->s1) - this->s2;
+            this->s2 = this->s1;
+            this->s1 = s;
+        }
+
+        /**
+         * Power of the frequency in the samples pushed since the last clear.
+        **/
+        float power(void) const {
+            float a = this->s1;
+            float b = this->s2;
+            return a * a + b * b - (this->coefficient / 8192.0f) * a * b;
+        }
+
+        /**
+         * 2 cos(w), the coefficient as a float.
+        **/
+        float cosine2(void) const {
+            return this->coefficient / 8192.0f;
+        }
+
+        int16_t getCoefficient(void) const {
+            return this->coefficient;
+        }
+
+    private:
+
+        int16_t coefficient;    // 2 cos(w), Q13
+        int32_t s1, s2;
+
+};
+
+/**
+ * Highest rate MainsDetector runs its Goertzel detectors at.
+**/
+constexpr float MAINS_DETECTOR_RATE = 1000;
+
+static_assert(goertzelCoefficient(50, MAINS_DETECTOR_RATE) != goertzelCoefficient(60, MAINS_DETECTOR_RATE),
+              "The mains detector can't tell 50 Hz from 60 Hz at MAINS_DETECTOR_RATE");
+
+/**
+ * Smallest shift that brings rate down to at most limit, at most 7.
+**/
+constexpr uint8_t decimationShift(const float rate, const float limit, const uint8_t shift = 0) {
+    return (shift >= 7 || rate <= limit * (1 << shift)) ? shift : decimationShift(rate, limit, shift + 1);
+}
+
+/**
+ * Tells 50 Hz from 60 Hz mains hum. Samples are averaged in blocks of a power
+ * of two down to at most MAINS_DETECTOR_RATE first. Above that the two Q13
+ * coefficients get too close to tell apart (they are equal from about 30 kHz),
+ * and the longer measurement lets the Goertzel state outgrow multiplyQ13.
+ * At MAINS_DETECTOR_RATE and NOTCH_CALIBRATION_MS sized measurements of 10
+ * bit samples it stays within 21 bits.
+**/
+class MainsDetector {
+
+    public:
+
+        MainsDetector() : sum(0), last(0), left(0), count(0), shift(0) {};
+
+        /**
+         * Starts a measurement of milliseconds at rate. first is the sample
+         * before the measurement, to avoid a step at its start.
+         * 
+         * @return bool - False if 50 Hz and 60 Hz can't be told apart at rate.
+        **/
+        bool start(const float& rate, const uint16_t& milliseconds, const int16_t& first) {
+
+            this->shift = decimationShift(rate, MAINS_DETECTOR_RATE);
+            float decimated = rate / (1 << this->shift);
+            unsigned long blocks = (unsigned long)(decimated * milliseconds / 1000);
+
+            this->hz50.setFrequency(50, decimated);
+            this->hz60.setFrequency(60, decimated);
+            this->left = (blocks < 16) ? 16 : (blocks > 0xFFFF) ? 0xFFFF : blocks;
+            this->sum = 0;
+            this->count = 0;
+            this->last = first;
+
+            return this->hz50.getCoefficient() != this->hz60.getCoefficient();
+
+        }
+
+        /**
+         * @return bool - True once the measurement is complete.
+        **/
+        bool push(const int16_t& sample) {
+
+            this->sum += sample;
+            if (++this->count < (1 << this->shift)) return false;
+
+            // The first difference removes DC, which would otherwise build up in the Goertzel state //
+
+            int16_t average = this->sum >> this->shift;
+            int16_t difference = average - this->last;
+            this->last = average;
+            this->sum = 0;
+            this->count = 0;
+
+            this->hz50.push(difference);
+            this->hz60.push(difference);
+
+            return --this->left == 0;
+
+        }
+
+        /**
+         * @return uint8_t - 50 or 60, whichever was stronger.
+        **/
+        uint8_t mains(void) const {
+
+            // The first difference boosts a frequency by 2 - 2 cos(w), undo it before comparing //
+
+            float power50 = this->hz50.power() / (2 - this->hz50.cosine2());
+            float power60 = this->hz60.power() / (2 - this->hz60.cosine2());
+
+            return (power60 > power50) ? 60 : 50;
+
+        }
+
+    private:
+
+        Goertzel hz50, hz60;
+        int32_t sum;            // Samples of the current block
+        int16_t last;           // Previous block average
+        uint16_t left;          // Blocks left to measure
+        uint8_t count;          // Samples in the current block
+        uint8_t shift;          // log2 of the block size
+
+};
+
+/**
+ * Cascaded integrator comb decimator: averages factor samples ORDER times over
+ * and keeps one output per factor inputs, so the lower rate isn't polluted by
+ * aliased high frequencies. Each input costs ORDER 32 bit additions and each
+ * output ORDER subtractions, no multiplies.
+ *
+ * The gain is factor^ORDER, which is shifted out since factor is a power of two.
+ * The integrators are allowed to wrap, the combs undo the wrap exactly.
+**/
+template <uint8_t ORDER>
+class CicDecimator {
+
+    public:
+
+        CicDecimator() {
+            this->setFactor(1);
+        };
+
+        /**
+         * Sets how many inputs make one output, a power of two, and clears the state.
+        **/
+        void setFactor(const uint8_t& factor) {
+            this->factor = factor;
+            this->shift = 0;
+            for (uint8_t f = factor; f > 1; f >>= 1) {
+                this->shift += ORDER;
+            }
+            this->clear();
+        }
+
+        void clear(void) {
+            this->phase = 0;
+            for (uint8_t i = 0; i < ORDER; i++) {
+                this->integrators[i] = 0;
+                this->combs[i] = 0;
+            }
+        }
+
+        /**
+         * Feeds one input sample.
+         *
+         * @return bool - True if an output was produced into output.
+        **/
+        bool push(const int16_t& sample, int16_t& output) {
+
+            uint32_t acc = (uint32_t)(int32_t)sample;
+            for (uint8_t i = 0; i < ORDER; i++) {
+                this->integrators[i] += acc;
+                acc = this->integrators[i];
+            }
+
+            if (++this->phase < this->factor) return false;
+            this->phase = 0;
+
+            for (uint8_t i = 0; i < ORDER; i++) {
+                uint32_t delayed = this->combs[i];
+                this->combs[i] = acc;
+                acc -= delayed;
+            }
+
+            output = (int32_t)acc >> this->shift;
+            return true;
+
+        }
+
+        uint8_t getFactor(void) const { return this->factor; }
+
+    private:
+
+        uint32_t integrators[ORDER];
+        uint32_t combs[ORDER];      // Integrator output at the previous decimated sample
+        uint8_t factor;
+        uint8_t shift;              // ORDER * log2(factor)
+        uint8_t phase;              // Inputs since the last output
+
+};
+
+// Filter Chain Stages //
+
+/**
+ * Stages for Chain below. Each has process() and clear(), and takes its
+ * coefficients from template parameters, so they are constants the compiler
+ * folds into the code. RATE is the sample rate in Hz.
+**/
+
+/**
+ * Single pole lowpass, time constant rounded to a power of two samples.
+**/
+template <unsigned long RATE, unsigned int CUTOFF>
+class LowPass {
+
+    public:
+
+        static constexpr uint8_t shift = timeConstantShift((unsigned long)(RATE / (2 * DSP_PI * CUTOFF)));
+
+        LowPass() : acc(0) {};
+
+        void clear(void) { this->acc = 0; }
+
+        int16_t process(const int16_t& x) {
+            this->acc += (((int32_t)x << 16) - this->acc) >> shift;
+            return this->acc >> 16;
+        }
+
+    private:
+
+        int32_t acc;            // Output << 16
+
+};
+
+/**
+ * Single pole highpass, the input minus LowPass. The output is centered on 0.
+**/
+template <unsigned long RATE, unsigned int CUTOFF>
+class HighPass {
+
+    public:
+
+        void clear(void) { this->lowPass.clear(); }
+
+        int16_t process(const int16_t& x) {
+            return x - this->lowPass.process(x);
+        }
+
+    private:
+
+        LowPass<RATE, CUTOFF> lowPass;
+
+};
+
+/**
+ * Mains notch, see notchCoefficients.
+**/
+template <unsigned long RATE, unsigned int MAINS, unsigned int BANDWIDTH = 4>
+class Notch {
+
+    static_assert(notchUsable(MAINS, RATE, BANDWIDTH), "The notch can't be placed precisely at this sample rate");
+
+    public:
+
+        static constexpr BiquadCoefficients coefficients = notchCoefficients(MAINS, RATE, BANDWIDTH);
+
+        void clear(void) { this->biquad.clear(); }
+
+        int16_t process(const int16_t& x) {
+            return this->biquad.process(x, coefficients);
+        }
+
+    private:
+
+        Biquad biquad;
+
+};
+
+/**
+ * Full wave rectification around ZERO.
+**/
+template <int ZERO = 0>
+class Rectify {
+
+    public:
+
+        void clear(void) {}
+
+        int16_t process(const int16_t& x) {
+            return (x >= ZERO) ? (x - ZERO) : (ZERO - x);
+        }
+
+};
+
+/**
+ * Adds VALUE, to move a signal centered on 0 back into the ADC range.
+**/
+template <int VALUE>
+class Offset {
+
+    public:
+
+        void clear(void) {}
+
+        int16_t process(const int16_t& x) {
+            return x + VALUE;
+        }
+
+};
+
+template <unsigned long RATE, unsigned int CUTOFF> constexpr uint8_t LowPass<RATE, CUTOFF>::shift;
+template <unsigned long RATE, unsigned int MAINS, unsigned int BANDWIDTH> constexpr BiquadCoefficients Notch<RATE, MAINS, BANDWIDTH>::coefficients;
+
+/**
+ * Runs a sample through each stage in order. Every stage is a member, so
+ * there is no heap or virtual call and the compiler can inline the whole chain.
+ *
+ * Example: Chain<HighPass<5000, 20>, Notch<5000, 50>, Rectify<>, LowPass<5000, 10>>
+**/
+template <typename... STAGES>
+class Chain;
+
+template <>
+class Chain<> {
+
+    public:
+
+        void clear(void) {}
+
+        int16_t process(const int16_t& x) {
+            return x;
+        }
+
+};
+
+template <typename FIRST, typename... REST>
+class Chain<FIRST, REST...> {
+
+    public:
+
+        void clear(void) {
+            this->first.clear();
+            this->rest.clear();
+        }
+
+        int16_t process(const int16_t& x) {
+            return this->rest.process(this->first.process(x));
+        }
+
+    private:
+
+        FIRST first;
+        Chain<REST...> rest;
+
+};
+
+/**
+ * Filter function for NeuroBoard::setSampleFilter running CHAIN, with separate
+ * state for each of the first CHANNELS scanned channels. Channels past that
+ * are passed through.
+ *
+ * Example: board.setSampleFilter(runChain<EmgChain>);
+**/
+template <typename CHAIN, uint8_t CHANNELS = 1>
+int16_t runChain(uint8_t slot, int16_t sample) {
+
+    static CHAIN chains[CHANNELS];
+
+    if (slot >= CHANNELS) return sample;
+
+    return chains[slot].process(sample);
+
+}
+
+/**
+ * Mean, mean square, minimum and maximum over the last length samples, each
+ * updated in constant (amortized) time per sample and read in constant time.
+ *
+ * Sums are kept running, the oldest sample is subtracted as it leaves. The
+ * minimum and maximum come from monotonic queues of sample positions: a new
+ * sample removes every queued sample it beats from the back of the queue, since
+ * those can never be the extreme again, so the front of the queue is always the
+ * extreme of the window.
+ *
+ * push() belongs to the ISR. The getters are single loads, callers reading
+ * several of them from loop() should do so with interrupts off.
+**/
+template <uint8_t SIZE>
+class SlidingWindow {
+
+    static_assert(SIZE > 0 && (SIZE & (SIZE - 1)) == 0, "Window size must be a power of two");
+    static_assert(SIZE <= 128, "Window size must fit single byte positions");
+
+    public:
+
+        SlidingWindow() {
+            this->setLength(0);
+        };
+
+        /**
+         * Empties the window and sets how many samples it covers, at most SIZE.
+        **/
+        void setLength(const uint8_t& length) {
+            this->length = length;
+            this->count = 0;
+            this->position = 0;
+            this->sum = 0;
+            this->sumSquares = 0;
+            this->minHead = this->minTail = 0;
+            this->maxHead = this->maxTail = 0;
+        }
+
+        void push(const int16_t& sample) {
+
+            uint8_t p = this->position;
+
+            // Running sums, the oldest sample leaves once the window is full //
+
+            if (this->count == this->length) {
+                int16_t oldest = this->samples[(uint8_t)(p - this->length) & MASK];
+                this->sum -= oldest;
+                this->sumSquares -= square(oldest);
+            } else {
+                this->count++;
+            }
+
+            this->samples[p & MASK] = sample;
+            this->sum += sample;
+            this->sumSquares += square(sample);
+
+            // Monotonic queues, increasing values for the minimum, decreasing for the maximum //
+            // The sample leaving the window goes first, a full queue would otherwise overwrite it //
+
+            if (this->minTail != this->minHead && (uint8_t)(p - this->minQueue[this->minHead & MASK]) >= this->length) this->minHead++;
+            while (this->minTail != this->minHead && this->at(this->minQueue[(uint8_t)(this->minTail - 1) & MASK]) >= sample) this->minTail--;
+            this->minQueue[this->minTail++ & MASK] = p;
+
+            if (this->maxTail != this->maxHead && (uint8_t)(p - this->maxQueue[this->maxHead & MASK]) >= this->length) this->maxHead++;
+            while (this->maxTail != this->maxHead && this->at(this->maxQueue[(uint8_t)(this->maxTail - 1) & MASK]) <= sample) this->maxTail--;
+            this->maxQueue[this->maxTail++ & MASK] = p;
+
+            this->position = p + 1;
+
+        }
+
+        uint8_t getLength(void) const { return this->length; }
+        uint8_t getCount(void) const { return this->count; }
+        int32_t getSum(void) const { return this->sum; }
+        uint32_t getSumSquares(void) const { return this->sumSquares; }
+        int16_t getMin(void) const { return this->count ? this->at(this->minQueue[this->minHead & MASK]) : 0; }
+        int16_t getMax(void) const { return this->count ? this->at(this->maxQueue[this->maxHead & MASK]) : 0; }
+
+    private:
+
+        static const uint8_t MASK = SIZE - 1;
+
+        int16_t samples[SIZE];
+        uint8_t minQueue[SIZE];     // Sample positions, oldest first
+        uint8_t maxQueue[SIZE];
+        uint8_t minHead, minTail;
+        uint8_t maxHead, maxTail;
+        uint8_t length;             // Samples covered, 0 disables the window
+        uint8_t count;              // Samples currently in the window, up to length
+        uint8_t position;           // Free running position of the next sample
+        int32_t sum;
+        uint32_t sumSquares;
+
+        int16_t at(const uint8_t& position) const {
+            return this->samples[position & MASK];
+        }
+
+        static uint32_t square(const int16_t& sample) {
+            uint16_t magnitude = (sample < 0) ? -sample : sample;
+            return (uint32_t)magnitude * magnitude;
+        }
+
+};
+
+/**
+ * Maps a value from one range onto another like map(), in constant time. The
+ * slope is kept as a fixed point fraction worked out once by set(), so each
+ * map() is one multiply and a shift instead of a division. Either range may
+ * run backwards (toHigh < toLow), and the result is rounded to the nearest
+ * value where map() truncates, so the two can differ by one.
+ *
+ * Output ranges under 128 keep 24 fractional bits, wider ones 16. The result
+ * is the exact nearest value as long as the square of the from range is
+ * below 2 to that many bits (4096 or 256 readings), past that it can be off
+ * by one next to a half way point.
+ *
+ * Ranges must span less than 32768 and values should be constrained to the
+ * from range first, or the product can overflow.
+**/
+class MapKernel {
+
+    public:
+
+        MapKernel() : fromLow(0), toLow(0), scale(0), shift(16) {};
+
+        MapKernel(const int16_t& fromLow, const int16_t& fromHigh, const int16_t& toLow, const int16_t& toHigh) {
+            this->set(fromLow, fromHigh, toLow, toHigh);
+        };
+
+        /**
+         * Works out the slope, an empty from range maps everything to toLow.
+        **/
+        void set(const int16_t& fromLow, const int16_t& fromHigh, const int16_t& toLow, const int16_t& toHigh) {
+
+            int32_t from = (int32_t)fromHigh - fromLow;
+            int32_t to = (int32_t)toHigh - toLow;
+
+            this->fromLow = fromLow;
+            this->toLow = toLow;
+            this->shift = (to > -128 && to < 128) ? 24 : 16;
+
+            to *= (int32_t)1 << this->shift;
+            this->scale = (from == 0) ? 0 : ((to < 0) == (from < 0) ? to + from / 2 : to - from / 2) / from;
+
+        }
+
+        int16_t map(const int16_t& value) const {
+            int32_t product = (int32_t)(value - this->fromLow) * this->scale;
+            return this->toLow + (int16_t)((this->shift == 24) ? (product + 0x800000) >> 24 : (product + 0x8000) >> 16);
+        }
+
+    private:
+
+        int16_t fromLow;
+        int16_t toLow;
+        int32_t scale;          // (toHigh - toLow) / (fromHigh - fromLow), shift fractional bits
+        uint8_t shift;          // 24 or 16, whole bytes so the shift is byte moves
+
+};
+
+/**
+ * List of the indices 0 to N - 1 as a parameter pack, MakeIndexList<N>::Type.
+ * Lets a constexpr function fill in a whole array at compile time.
+**/
+template <uint8_t... I>
+struct IndexList {};
+
+template <uint8_t N, uint8_t... I>
+struct MakeIndexList : MakeIndexList<N - 1, N - 1, I...> {};
+
+template <uint8_t... I>
+struct MakeIndexList<0, I...> {
+    typedef IndexList<I...> Type;
+};
+
+/**
+ * Mapping of a range baked into an array, entry i holds the mapped value of
+ * the inputs fromLow + (i << shift) to fromLow + ((i + 1) << shift) - 1.
+ * Meant for PROGMEM, see mapTable.
+**/
+template <uint8_t SIZE>
+struct MapTable {
+    uint8_t shift;              // Inputs per entry, as a shift
+    uint8_t values[SIZE];
+};
+
+/**
+ * Smallest shift that fits span + 1 inputs into size entries.
+**/
+constexpr uint8_t mapTableShift(const long span, const uint8_t size, const uint8_t shift = 0) {
+    return ((span >> shift) < size) ? shift : mapTableShift(span, size, shift + 1);
+}
+
+/**
+ * Twice the middle of the inputs first to last, counted from fromLow. Entries
+ * that run past the end of the range stop at it.
+**/
+constexpr long mapTableMiddle(const long first, const long last, const long span) {
+    return (first >= span) ? 2 * span : first + ((last < span) ? last : span);
+}
+
+/**
+ * Mapping of an input given as twice its distance from fromLow, rounded to
+ * the nearest value.
+**/
+constexpr uint8_t mapTableEntry(const long twice, const long span, const long toLow, const long toHigh) {
+    return toLow + (twice * (toHigh - toLow) + ((toHigh < toLow) ? -span : span)) / (2 * span);
+}
+
+template <uint8_t... I>
+constexpr MapTable<sizeof...(I)> makeMapTable(const uint8_t shift, const long span, const long toLow, const long toHigh, IndexList<I...>) {
+    return MapTable<sizeof...(I)>{ shift, { mapTableEntry(mapTableMiddle((long)I << shift, (((long)I + 1) << shift) - 1, span), span, toLow, toHigh)... } };
+}
+
+/**
+ * Builds a MapTable of SIZE entries at compile time, spread over fromLow to
+ * fromHigh (fromHigh > fromLow) rather than over every possible input, so a
+ * short range gets one entry per input. Each entry is the mapping of the
+ * middle input it covers, so the error is at most half an entry's inputs
+ * plus the rounding of the output.
+ *
+ * Look up an input constrained to the range at
+ * values[(input - fromLow) >> shift].
+ *
+ * Example: const MapTable<128> table PROGMEM = mapTable<128>(30, 1023, 0, 8);
+**/
+template <uint8_t SIZE>
+constexpr MapTable<SIZE> mapTable(const long fromLow, const long fromHigh, const long toLow, const long toHigh) {
+    return makeMapTable(mapTableShift(fromHigh - fromLow, SIZE), fromHigh - fromLow, toLow, toHigh, typename MakeIndexList<SIZE>::Type());
+}
+
+#endif // NEURO_DSP_HPP
@@ -0,0 +1,334 @@
+/**
+    NeuroRingBuffer.hpp - A library for interacting with the Neuroduino Board.
+    Copyright (C) 2021 Backyard Brains
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+    USA
+
+    Backyard Brains hereby disclaims all copyright interest in the library
+    `NeuroBoard` (a library for interacting with the Neuroduino Board) written
+    by Benjamin Antonellis.
+
+    Backyard Brains, March 2021.
+**/
+
+/**
+ * Single producer / single consumer ring buffer, shared between an ISR
+ * (producer) and loop() (consumer).
+ *
+ * head and tail are free running single byte counters, so each is written
+ * with one store and can be read by the other side without a lock. The
+ * element index is counter & mask, which is why sizes must be a power of two.
+ * The fill level is (head - tail), which stays correct across the 8 bit wrap
+ * as long as the size is at most 128.
+**/
+
+#pragma once
+
+#ifndef NEURO_RING_BUFFER_HPP
+#define NEURO_RING_BUFFER_HPP
+
+#include <stdint.h>
+#include <string.h>
+#include <util/atomic.h>
+
+#define RING_BUFFER_MAX_SIZE 128
+
+// Keeps the compiler from moving element stores past the index store that publishes them //
+#define RING_BUFFER_BARRIER() __asm__ __volatile__ ("" ::: "memory")
+
+/**
+ * What push() does when the buffer is full.
+ *
+ * OVERWRITE_OLDEST: The oldest element is discarded so the newest is always kept.
+ *                   The producer also moves tail, so pop() takes a short critical section.
+ * DROP_NEWEST:      The new element is discarded. The producer only ever writes head
+ *                   and the consumer only ever writes tail, so neither side locks.
+**/
+enum OverrunPolicy {
+    OVERWRITE_OLDEST,
+    DROP_NEWEST
+};
+
+/**
+ * Ring buffer over storage provided by the caller. See StaticRingBuffer for
+ * a buffer that owns its storage.
+**/
+template <typename T, OverrunPolicy POLICY = OVERWRITE_OLDEST>
+class RingBuffer {
+
+    public:
+
+        /**
+         * Contiguous run of elements inside the buffer's storage.
+        **/
+        struct Span {
+            const T* data;
+            uint8_t length;
+        };
+
+        RingBuffer() : data(nullptr), mask(0), head(0), tail(0), overruns(0), peekTail(0) {};
+
+        /**
+         * Binds the buffer to its storage and empties it.
+         *
+         * @param storage Array of at least size elements.
+         * @param size Power of two, at most RING_BUFFER_MAX_SIZE.
+        **/
+        void attach(T* storage, const uint8_t& size) {
+            ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                this->data = storage;
+                this->mask = size - 1;
+                this->head = 0;
+                this->tail = 0;
+            }
+        }
+
+        /**
+         * Adds an element. Producer side, call from the ISR.
+         *
+         * @return bool - False if an element was lost to the overrun policy.
+        **/
+        bool push(const T& value) {
+
+            uint8_t h = this->head;
+
+            if ((uint8_t)(h - this->tail) > this->mask) {
+                if (this->overruns != 0xFFFF) this->overruns = this->overruns + 1;
+                if (POLICY == DROP_NEWEST) return false;
+                this->tail = this->tail + 1; // Discard the oldest before its slot is reused
+                RING_BUFFER_BARRIER();
+                this->data[h & this->mask] = value;
+                RING_BUFFER_BARRIER();
+                this->head = h + 1;
+                return false;
+            }
+
+            this->data[h & this->mask] = value;
+            RING_BUFFER_BARRIER();
+            this->head = h + 1;
+            return true;
+
+        }
+
+        /**
+         * Removes the oldest element. Consumer side, call from loop().
+         *
+         * @return bool - False if the buffer was empty, value is left untouched.
+        **/
+        bool pop(T& value) {
+
+            if (POLICY == OVERWRITE_OLDEST) {
+                bool popped = false;
+                ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                    popped = this->popUnlocked(value);
+                }
+                return popped;
+            }
+
+            return this->popUnlocked(value);
+
+        }
+
+        /**
+         * Removes up to max elements into dst, oldest first, in one critical section.
+         * Consumer side, call from loop().
+         *
+         * @param dst Array of at least max elements.
+         * @param max Most elements to copy.
+         *
+         * @return uint8_t - Number of elements copied.
+        **/
+        uint8_t read(T* dst, const uint8_t& max) {
+
+            uint8_t count = 0;
+
+            ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+
+                uint8_t t = this->tail;
+                count = (uint8_t)(this->head - t);
+                if (count > max) count = max;
+
+                // Copy the part up to the end of storage, then the wrapped part //
+
+                uint8_t first = this->mask + 1 - (t & this->mask);
+                if (first > count) first = count;
+                memcpy(dst, &this->data[t & this->mask], first * sizeof(T));
+                memcpy(dst + first, this->data, (count - first) * sizeof(T));
+
+                RING_BUFFER_BARRIER();
+                this->tail = t + count;
+
+            }
+
+            return count;
+
+        }
+
+        /**
+         * Points spans at the waiting elements without copying them, oldest first.
+         * The second span is only used when the elements wrap around the end of
+         * storage. Nothing is removed until commit() is called. Consumer side.
+         *
+         * With OVERWRITE_OLDEST, a producer that laps the consumer rewrites
+         * elements while they are being read. commit() reports how many.
+         *
+         * @param spans Array of two spans to fill in.
+         *
+         * @return uint8_t - Total number of elements in both spans.
+        **/
+        uint8_t peek(Span spans[2]) {
+
+            uint8_t t, count;
+
+            ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                t = this->tail;
+                count = (uint8_t)(this->head - t);
+            }
+            this->peekTail = t;
+
+            uint8_t first = this->mask + 1 - (t & this->mask);
+            if (first > count) first = count;
+
+            spans[0].data = &this->data[t & this->mask];
+            spans[0].length = first;
+            spans[1].data = this->data;
+            spans[1].length = count - first;
+
+            return count;
+
+        }
+
+        /**
+         * Removes count elements returned by the last peek(). Consumer side.
+         *
+         * @param count Number of elements processed, at most what peek() returned.
+         *
+         * @return uint8_t - How many of those elements the producer overwrote
+         *                   while they were being processed (OVERWRITE_OLDEST only).
+        **/
+        uint8_t commit(const uint8_t& count) {
+
+            uint8_t overwritten = 0;
+
+            ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+
+                // The producer moves tail on its own when it overwrites //
+
+                uint8_t moved = (uint8_t)(this->tail - this->peekTail);
+                overwritten = (moved < count) ? moved : count;
+                if (moved < count) {
+                    RING_BUFFER_BARRIER();
+                    this->tail = this->peekTail + count;
+                }
+
+            }
+
+            return overwritten;
+
+        }
+
+        /**
+         * Returns how many elements were lost to the overrun policy since the
+         * last call, and restarts the count.
+        **/
+        uint16_t takeOverruns(void) {
+            uint16_t count;
+            ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                count = this->overruns;
+                this->overruns = 0;
+            }
+            return count;
+        }
+
+        /**
+         * Returns the newest element without removing anything, or a default T if
+         * nothing was ever pushed.
+        **/
+        T last(void) const {
+            T value = T();
+            ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                if (this->data) value = this->data[(uint8_t)(this->head - 1) & this->mask];
+            }
+            return value;
+        }
+
+        /**
+         * Number of elements waiting to be popped.
+        **/
+        uint8_t available(void) const {
+            return (uint8_t)(this->head - this->tail);
+        }
+
+        uint8_t capacity(void) const {
+            return this->mask + 1;
+        }
+
+        bool empty(void) const {
+            return this->head == this->tail;
+        }
+
+        /**
+         * Discards everything waiting. Consumer side.
+        **/
+        void clear(void) {
+            this->tail = this->head;
+        }
+
+    protected:
+
+        T* data;
+        uint8_t mask;
+        volatile uint8_t head;      // Written by the producer only
+        volatile uint8_t tail;      // Written by the consumer (and by the producer when overwriting)
+        volatile uint16_t overruns; // Elements lost to the overrun policy, saturates at 0xFFFF
+        uint8_t peekTail;           // Tail seen by the last peek(), consumer only
+
+        bool popUnlocked(T& value) {
+
+            uint8_t t = this->tail;
+            if (this->head == t) return false;
+
+            value = this->data[t & this->mask];
+            RING_BUFFER_BARRIER();
+            this->tail = t + 1;
+            return true;
+
+        }
+
+};
+
+/**
+ * Ring buffer with statically allocated storage of SIZE elements.
+**/
+template <typename T, uint8_t SIZE, OverrunPolicy POLICY = OVERWRITE_OLDEST>
+class StaticRingBuffer : public RingBuffer<T, POLICY> {
+
+    static_assert(SIZE > 0 && (SIZE & (SIZE - 1)) == 0, "Ring buffer size must be a power of two");
+    static_assert(SIZE <= RING_BUFFER_MAX_SIZE, "Ring buffer size must fit single byte indices");
+
+    public:
+
+        StaticRingBuffer() {
+            this->attach(this->storage, SIZE);
+        };
+
+    private:
+
+        T storage[SIZE];
+
+};
+
+#endif // NEURO_RING_BUFFER_HPP
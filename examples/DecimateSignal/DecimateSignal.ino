@@ -0,0 +1,85 @@
+/**
+	NeuroBoard - A library for interacting with the Neuroduino Board.
+    Copyright (C) 2021 Backyard Brains
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+    USA
+    
+	Backyard Brains hereby disclaims all copyright interest in the library
+	`NeuroBoard` (a library for interacting with the Neuroduino Board) written
+	by Benjamin Antonellis.
+
+	Backyard Brains, March 2021
+**/
+
+/**
+ * Program to sample fast and read slow. The board samples at 4000 samples per
+ * second, and a CIC decimator turns that into 125 samples per second for the
+ * plotter without aliasing. Every 5 seconds decimation is switched on or off,
+ * and the difference in average interrupt cycles is its cost per input sample.
+ * 
+ * MAC:
+ * 	View Console: Shift + Command + M
+ * 	View Plotter: Shift + Command + L
+ * 
+ * WINDOWS:
+ * 	View Console: Control + Shift + M
+ *  View Plotter: Control + Shift + L
+ * 
+ * @author Ben Antonellis
+ * @date January 7th, 2021
+**/
+
+#include "NeuroBoard.hpp"
+
+NeuroBoard board;
+
+ulong toggleTimer = 0;
+bool decimating = true;
+
+void setup() {
+
+	// Required to start receiving samples from the board //
+	board.startMeasurements();
+
+	board.setSampleRate<4000>();
+	board.setSamplingMode(ASYNC_SAMPLING);
+	board.setDecimation(32);
+
+}
+
+void loop() {
+
+	if (wait(5000, toggleTimer)) {
+
+		AcquisitionStats stats = board.getStats();
+		Serial.print(decimating ? "Decimation on, avg cycles: " : "Decimation off, avg cycles: ");
+		Serial.println(stats.avgISRCycles);
+
+		decimating = !decimating;
+		board.setDecimation(decimating ? 32 : 0);
+		board.resetStats();
+
+	}
+
+	// One decimated sample arrives every 8 ms //
+
+	if (decimating) {
+		Serial.println(board.getNewDecimatedSample());
+	}
+
+	delay(8);
+
+}
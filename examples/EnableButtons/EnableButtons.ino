@@ -65,7 +65,17 @@ void setup() {
 	board.enableButtonLongPress(RED_BTN, 1000, []() {
     	Serial.println("Red Button Held For 1 Second!");
 	});
-	
+
+	// With a double press enabled, a single press of the white button is only
+	// reported once DOUBLE_PRESS_MS has passed without a second press.
+
+	board.enableButtonDoublePress(WHITE_BTN, []() {
+		Serial.println("White Button Double Pressed!");
+	});
+
+	// Gestures that have no helper, like a button that repeats while held,
+	// are shown in the ButtonGestures example.
+
 }
 
 void loop() {
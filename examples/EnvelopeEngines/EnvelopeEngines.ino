@@ -0,0 +1,90 @@
+/**
+	NeuroBoard - A library for interacting with the Neuroduino Board.
+    Copyright (C) 2021 Backyard Brains
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+    USA
+    
+	Backyard Brains hereby disclaims all copyright interest in the library
+	`NeuroBoard` (a library for interacting with the Neuroduino Board) written
+	by Benjamin Antonellis.
+
+	Backyard Brains, March 2021
+**/
+
+/**
+ * Program to compare the envelope engines. Every 5 seconds the next engine is
+ * selected, and the average and worst case CPU cycles the sample interrupt
+ * spends per sample are printed next to the envelope value. Async sampling is
+ * used so the cycle counts aren't hidden behind analogRead().
+ * 
+ * MAC:
+ * 	View Console: Shift + Command + M
+ * 	View Plotter: Shift + Command + L
+ * 
+ * WINDOWS:
+ * 	View Console: Control + Shift + M
+ *  View Plotter: Control + Shift + L
+ * 
+ * @author Ben Antonellis
+ * @date January 7th, 2021
+**/
+
+#include "NeuroBoard.hpp"
+
+NeuroBoard board;
+
+const char* names[] = {"PEAK_DECAY", "PEAK_HOLD", "LOWPASS", "RMS"};
+
+ulong engineTimer = 0;
+int engine = PEAK_DECAY_ENVELOPE;
+
+void setup() {
+
+	// Required to start receiving samples from the board //
+	board.startMeasurements();
+
+	board.setSampleRate<5000>();
+	board.setSamplingMode(ASYNC_SAMPLING);
+
+	// 50 ms time constant, the SpikerShield output is already rectified //
+	board.setEnvelopeEngine(engine, 50, 0);
+
+}
+
+void loop() {
+
+	// Move on to the next engine every 5 seconds //
+
+	if (wait(5000, engineTimer)) {
+		engine = (engine + 1) % 4;
+		board.setEnvelopeEngine(engine, 50, 0);
+		board.resetStats();
+	}
+
+	// Samples aren't read here, so overruns are expected //
+
+	AcquisitionStats stats = board.getStats();
+	Serial.print(names[engine]);
+	Serial.print(" envelope: ");
+	Serial.print(board.getEnvelopeValue());
+	Serial.print(" avg/max cycles: ");
+	Serial.print(stats.avgISRCycles);
+	Serial.print("/");
+	Serial.println(stats.maxISRCycles);
+
+	delay(500);
+
+}
@@ -0,0 +1,90 @@
+/**
+	NeuroBoard - A library for interacting with the Neuroduino Board.
+    Copyright (C) 2021 Backyard Brains
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+    USA
+    
+	Backyard Brains hereby disclaims all copyright interest in the library
+	`NeuroBoard` (a library for interacting with the Neuroduino Board) written
+	by Benjamin Antonellis.
+
+	Backyard Brains, March 2021
+**/
+
+/**
+ * Program to build a filter chain and measure what each stage costs. Every
+ * 5 seconds one more stage is added to the chain run by the sample interrupt,
+ * and the average interrupt cycles are printed. The difference between two
+ * lines is the cost of the stage that was added.
+ * 
+ * MAC:
+ * 	View Console: Shift + Command + M
+ * 	View Plotter: Shift + Command + L
+ * 
+ * WINDOWS:
+ * 	View Console: Control + Shift + M
+ *  View Plotter: Control + Shift + L
+ * 
+ * @author Ben Antonellis
+ * @date January 7th, 2021
+**/
+
+#include "NeuroBoard.hpp"
+
+#define RATE 2000
+
+NeuroBoard board;
+
+// Chains that grow by one stage each //
+
+typedef Chain<HighPass<RATE, 20>> Stage1;
+typedef Chain<HighPass<RATE, 20>, Notch<RATE, 60>> Stage2;
+typedef Chain<HighPass<RATE, 20>, Notch<RATE, 60>, Rectify<>> Stage3;
+typedef Chain<HighPass<RATE, 20>, Notch<RATE, 60>, Rectify<>, LowPass<RATE, 10>> Stage4;
+
+int16_t (*filters[])(uint8_t, int16_t) = {nullptr, runChain<Stage1>, runChain<Stage2>, runChain<Stage3>, runChain<Stage4>};
+const char* names[] = {"no filter", "+ HighPass", "+ Notch", "+ Rectify", "+ LowPass"};
+
+ulong stageTimer = 0;
+int stage = 0;
+
+void setup() {
+
+	// Required to start receiving samples from the board //
+	board.startMeasurements();
+
+	board.setSampleRate<RATE>();
+	board.setSamplingMode(ASYNC_SAMPLING);
+
+}
+
+void loop() {
+
+	if (wait(5000, stageTimer)) {
+
+		AcquisitionStats stats = board.getStats();
+		Serial.print(names[stage]);
+		Serial.print(": ");
+		Serial.print(stats.avgISRCycles);
+		Serial.println(" cycles per sample");
+
+		stage = (stage + 1) % 5;
+		board.setSampleFilter(filters[stage]);
+		board.resetStats();
+
+	}
+
+}
@@ -0,0 +1,121 @@
+/**
+	NeuroBoard - A library for interacting with the Neuroduino Board.
+    Copyright (C) 2021 Backyard Brains
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+    USA
+    
+	Backyard Brains hereby disclaims all copyright interest in the library
+	`NeuroBoard` (a library for interacting with the Neuroduino Board) written
+	by Benjamin Antonellis.
+
+	Backyard Brains, March 2021
+**/
+
+/**
+ * Program to compare the cost of refreshing the LED bar one LED at a time, the
+ * way displayEMGStrength used to, against writeLEDBar. Prints the average CPU
+ * cycles per refresh for a bar that changes height every time, and for one
+ * that stays the same (writeLEDBar then skips the transfer).
+ * 
+ * Measurements are not started, so the sample interrupt doesn't skew the timing.
+ * With NEUROBOARD_LED_SPI defined, the times include waiting for the SPI. With
+ * NEUROBOARD_LED_SPI_INTERRUPT as well, they only cover starting each transfer,
+ * the SPI interrupt finishes it in the background.
+ * 
+ * MAC:
+ * 	View Console: Shift + Command + M
+ * 	View Plotter: Shift + Command + L
+ * 
+ * WINDOWS:
+ * 	View Console: Control + Shift + M
+ *  View Plotter: Control + Shift + L
+ * 
+ * @author Ben Antonellis
+ * @date January 7th, 2021
+**/
+
+#include "NeuroBoard.hpp"
+
+#define REFRESHES 1000
+
+NeuroBoard board;
+
+/**
+ * The old refresh: every LED off, then the lit ones on, each call shifting out the whole bar.
+**/
+void writeBarPerLED(const uint8_t& height) {
+
+	for (int i = 0; i < MAX_LEDS; i++) {
+		board.writeLED(i, OFF);
+	}
+
+	for (int i = 0; i < height; i++) {
+		board.writeLED(i, ON);
+	}
+
+}
+
+/**
+ * Turns the micros() spent on refreshes into cycles per refresh.
+**/
+ulong cyclesPerRefresh(const ulong& elapsed) {
+	return elapsed * (F_CPU / 1000000UL) / REFRESHES;
+}
+
+void setup() {
+
+	Serial.begin(9600);
+	while (!Serial);
+
+	// Shift register pins, normally set up by startMeasurements //
+
+	pinMode(14, OUTPUT);
+	pinMode(15, OUTPUT);
+	pinMode(16, OUTPUT);
+
+	ulong start = micros();
+	for (int i = 0; i < REFRESHES; i++) {
+		writeBarPerLED(i % (MAX_LEDS + 1));
+	}
+	ulong perLED = micros() - start;
+
+	start = micros();
+	for (int i = 0; i < REFRESHES; i++) {
+		board.writeLEDBar(i % (MAX_LEDS + 1));
+	}
+	ulong changing = micros() - start;
+
+	start = micros();
+	for (int i = 0; i < REFRESHES; i++) {
+		board.writeLEDBar(MAX_LEDS / 2);
+	}
+	ulong unchanged = micros() - start;
+
+	Serial.print("writeLED per LED: ");
+	Serial.print(cyclesPerRefresh(perLED));
+	Serial.println(" cycles per refresh");
+
+	Serial.print("writeLEDBar, height changing: ");
+	Serial.print(cyclesPerRefresh(changing));
+	Serial.println(" cycles per refresh");
+
+	Serial.print("writeLEDBar, height unchanged: ");
+	Serial.print(cyclesPerRefresh(unchanged));
+	Serial.println(" cycles per refresh");
+
+}
+
+void loop() {}
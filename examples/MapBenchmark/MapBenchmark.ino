@@ -0,0 +1,176 @@
+/**
+	NeuroBoard - A library for interacting with the Neuroduino Board.
+    Copyright (C) 2021 Backyard Brains
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+    USA
+    
+	Backyard Brains hereby disclaims all copyright interest in the library
+	`NeuroBoard` (a library for interacting with the Neuroduino Board) written
+	by Benjamin Antonellis.
+
+	Backyard Brains, March 2021
+**/
+
+/**
+ * Program to compare the cost of mapping an EMG reading to a servo angle with
+ * map(), with the loop based fasterMap() the library used to have, with
+ * MapKernel (KERNEL_MAPPING) and with a PROGMEM table (TABLE_MAPPING). Prints
+ * the average CPU cycles per call for every sensitivity of the servo code, how
+ * far MapKernel and the table stray from map(), and the RAM and flash taken
+ * by the backend the library was built with.
+ * 
+ * Define SERVO_MAPPING as TABLE_MAPPING in the build flags (or NeuroBoard.hpp)
+ * to switch the library to the tables.
+ * 
+ * Measurements are not started, so the sample interrupt doesn't skew the timing.
+ * 
+ * MAC:
+ * 	View Console: Shift + Command + M
+ * 	View Plotter: Shift + Command + L
+ * 
+ * WINDOWS:
+ * 	View Console: Control + Shift + M
+ *  View Plotter: Control + Shift + L
+ * 
+ * @author Ben Antonellis
+ * @date January 7th, 2021
+**/
+
+#include "NeuroBoard.hpp"
+
+// The same tables TABLE_MAPPING builds for CLOSED_MODE, generated by the compiler //
+
+const SensitivityTables closedTables PROGMEM = sensitivityTables(120, 105, 190);
+
+volatile long sink = 0; // Keeps the compiler from dropping the calls being timed
+
+/**
+ * The mapping the library used before MapKernel, kept here for comparison.
+ * Descending output ranges always return toLow.
+**/
+long fasterMap(long value, long fromLow, long fromHigh, long toLow, long toHigh) {
+
+	long first = value - fromLow;
+	long second = toHigh - toLow;
+	long combined = 0;
+	while (second > 0) {
+		combined = combined + first;
+		second = second - 1;
+	}
+	long third = fromHigh - fromLow;
+	long count = 0;
+	while (combined >= third) {
+		combined = combined - third;
+		count = count + 1;
+	}
+	count = count + toLow;
+	return count;
+
+}
+
+/**
+ * Turns the micros() spent on calls into cycles per call.
+**/
+ulong cyclesPerCall(const ulong& elapsed, const ulong& calls) {
+	return elapsed * (F_CPU / 1000000UL) / calls;
+}
+
+void setup() {
+
+	Serial.begin(9600);
+	while (!Serial);
+
+	Serial.print("SERVO_MAPPING RAM: ");
+	Serial.print(SERVO_MAPPING_RAM);
+	Serial.print(" bytes, flash: ");
+	Serial.print(SERVO_MAPPING_FLASH);
+	Serial.println(" bytes");
+
+	Serial.println("saturation, map(), fasterMap(), MapKernel, table, kernel difference, table difference");
+
+	for (int i = 0; i < SENSITIVITY_LEVELS; i++) {
+
+		// CLOSED_MODE servo mapping, the one both old and new code get right //
+
+		int saturation = servoSensitivity(i);
+		ulong calls = saturation - 120 + 1;
+		MapKernel kernel(120, saturation, 105, 190);
+		const MapTable<MAP_TABLE_SIZE>& table = closedTables.levels[i];
+		uint8_t shift = pgm_read_byte(&table.shift);
+
+		ulong start = micros();
+		for (int value = 120; value <= saturation; value++) {
+			sink = map(value, 120, saturation, 105, 190);
+		}
+		ulong mapTime = micros() - start;
+
+		start = micros();
+		for (int value = 120; value <= saturation; value++) {
+			sink = fasterMap(value, 120, saturation, 105, 190);
+		}
+		ulong fasterTime = micros() - start;
+
+		start = micros();
+		for (int value = 120; value <= saturation; value++) {
+			sink = kernel.map(value);
+		}
+		ulong kernelTime = micros() - start;
+
+		start = micros();
+		for (int value = 120; value <= saturation; value++) {
+			sink = pgm_read_byte(&table.values[(constrain(value, 120, saturation) - 120) >> shift]);
+		}
+		ulong tableTime = micros() - start;
+
+		long kernelDifference = 0;
+		long tableDifference = 0;
+		for (int value = 120; value <= saturation; value++) {
+			long expected = map(value, 120, saturation, 105, 190);
+			long kernelError = abs(kernel.map(value) - expected);
+			long tableError = abs(pgm_read_byte(&table.values[(value - 120) >> shift]) - expected);
+			if (kernelError > kernelDifference) kernelDifference = kernelError;
+			if (tableError > tableDifference) tableDifference = tableError;
+		}
+
+		Serial.print(saturation);
+		Serial.print(", ");
+		Serial.print(cyclesPerCall(mapTime, calls));
+		Serial.print(", ");
+		Serial.print(cyclesPerCall(fasterTime, calls));
+		Serial.print(", ");
+		Serial.print(cyclesPerCall(kernelTime, calls));
+		Serial.print(", ");
+		Serial.print(cyclesPerCall(tableTime, calls));
+		Serial.print(", ");
+		Serial.print(kernelDifference);
+		Serial.print(", ");
+		Serial.println(tableDifference);
+
+	}
+
+	// The OPEN_MODE mapping runs backwards, which fasterMap() got wrong //
+
+	MapKernel open(40, 1024, 190, 105);
+	Serial.print("OPEN_MODE at 1024: map() ");
+	Serial.print(map(1024, 40, 1024, 190, 105));
+	Serial.print(", fasterMap() ");
+	Serial.print(fasterMap(1024, 40, 1024, 190, 105));
+	Serial.print(", MapKernel ");
+	Serial.println(open.map(1024));
+
+}
+
+void loop() {}
@@ -0,0 +1,88 @@
+/**
+	NeuroBoard - A library for interacting with the Neuroduino Board.
+    Copyright (C) 2021 Backyard Brains
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+    USA
+    
+	Backyard Brains hereby disclaims all copyright interest in the library
+	`NeuroBoard` (a library for interacting with the Neuroduino Board) written
+	by Benjamin Antonellis.
+
+	Backyard Brains, March 2021
+**/
+
+/**
+ * Program to compare the two sampling modes. Prints how many CPU cycles the
+ * interrupts spend on each sample, first while blocking on analogRead(), then
+ * while the ADC interrupt collects the conversion.
+ * 
+ * MAC:
+ * 	View Console: Shift + Command + M
+ * 	View Plotter: Shift + Command + L
+ * 
+ * WINDOWS:
+ * 	View Console: Control + Shift + M
+ *  View Plotter: Control + Shift + L
+ * 
+ * @author Ben Antonellis
+ * @date January 7th, 2021
+**/
+
+#include "NeuroBoard.hpp"
+
+NeuroBoard board;
+
+ulong modeTimer = 0;
+bool async = false;
+
+void setup() {
+
+	// Required to start receiving samples from the board //
+	board.startMeasurements();
+
+	// BLOCKING_SAMPLING is the default, analogRead() is called inside the timer interrupt //
+	board.setSamplingMode(BLOCKING_SAMPLING);
+
+}
+
+void loop() {
+
+	// Swap sampling modes every 5 seconds //
+
+	if (wait(5000, modeTimer)) {
+		async = !async;
+		board.setSamplingMode(async ? ASYNC_SAMPLING : BLOCKING_SAMPLING);
+	}
+
+	Serial.print(async ? "ASYNC_SAMPLING: " : "BLOCKING_SAMPLING: ");
+	Serial.print(board.getISRCycles());
+	Serial.println(" cycles per sample");
+
+	// Health counters, overruns climb here because loop() never reads the samples //
+
+	AcquisitionStats stats = board.getStats();
+	Serial.print("avg/max cycles: ");
+	Serial.print(stats.avgISRCycles);
+	Serial.print("/");
+	Serial.print(stats.maxISRCycles);
+	Serial.print(" overruns: ");
+	Serial.print(stats.overruns);
+	Serial.print(" sequence: ");
+	Serial.println(stats.sequence);
+
+	delay(500);
+
+}
\ No newline at end of file
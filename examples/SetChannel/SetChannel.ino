@@ -71,10 +71,20 @@ void setup() {
 
 	board.setChannel(A0);
 
+	// To record several muscles with one board, you can scan a set of channels instead.
+	// Every channel is sampled each tick and gets its own buffer and envelope value.
+
+	uint8_t muscles[] = {A0, A1};
+	board.setChannels(muscles, 2);
+
 }
 
 void loop() {
 
-	// loop code here
+	// Read each scanned channel by passing it in //
+
+	Serial.print(board.getEnvelopeValue(A0));
+	Serial.print("\t");
+	Serial.println(board.getEnvelopeValue(A1));
 
 }
\ No newline at end of file
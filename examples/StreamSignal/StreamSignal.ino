@@ -0,0 +1,66 @@
+/**
+	NeuroBoard - A library for interacting with the Neuroduino Board.
+    Copyright (C) 2021 Backyard Brains
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+    USA
+    
+	Backyard Brains hereby disclaims all copyright interest in the library
+	`NeuroBoard` (a library for interacting with the Neuroduino Board) written
+	by Benjamin Antonellis.
+
+	Backyard Brains, March 2021
+**/
+
+/**
+ * Simple program that streams the signal to the computer in the compact binary
+ * format used by the Backyard Brains SpikeRecorder. Much higher sample rates
+ * fit through the serial port than with PrintSignal, but the Arduino Serial
+ * Console/Plotter can't display it. Open the port in SpikeRecorder, or run
+ * extras/decode_stream.py.
+ * 
+ * @author Ben Antonellis
+ * @date January 7th, 2021
+**/
+
+#include "NeuroBoard.hpp"
+
+NeuroBoard board;
+
+void setup() {
+
+	// Required to start receiving samples from the board //
+	board.startMeasurements();
+
+	// Spike recordings need a much higher rate than the default //
+	board.setSampleRate<5000>();
+
+	// Send every sample to the computer straight from the sample interrupt, so //
+	// streaming keeps going no matter what loop() is doing.                    //
+	board.startStreaming(ISR_STREAMING);
+
+	// Alternatively, LOOP_STREAMING sends samples from handleInputs() instead //
+	// board.startStreaming(LOOP_STREAMING);
+
+}
+
+void loop() {
+
+	// Required if any button/envelopeTrigger/servo is enabled, and for LOOP_STREAMING //
+	board.handleInputs();
+
+	// loop code here, delays don't interrupt ISR_STREAMING //
+
+}
\ No newline at end of file
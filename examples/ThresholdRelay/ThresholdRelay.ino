@@ -52,11 +52,24 @@ void setup() {
 	// function passed is called. Then, once the samples reached 9/10th of the passed
 	// threshold (630 in this case), the function will be allowed to call again.
 
-	// Once the threshold is met, the relay is turned on. It is only turned off when
-	// the incoming samples are below the second threshold.
+	// Once the threshold is met, the relay is pulsed. The sample interrupt times the
+	// pulses, so loop() keeps running while they play, and times are rounded to whole
+	// sample ticks. At the default 250 samples/second a tick is 4ms, so the default
+	// single pulse is 4ms long. Sampling at 2000 samples/second gives 500us steps,
+	// for a burst of 3 pulses of 500us with 10ms between them.
+
+	board.setSampleRate(2000);
+	board.setRelayPulse(500, 3, 10000);
+
+	// The crossing itself is detected by the sample interrupt and timestamped, the
+	// function is called from handleInputs. getLastTriggerEvent tells when the
+	// threshold was really crossed, no matter how slow loop() is.
 
 	board.setTriggerOnEnvelope(700, []() {
-		Serial.println("Threshold Reached!");
+		TriggerEvent event = board.getLastTriggerEvent();
+		Serial.print("Threshold Reached! Called back ");
+		Serial.print(micros() - event.micros);
+		Serial.println(" us after the crossing");
 	});
 
 	// You can also set your own second threshold. The following code executes the function once
@@ -64,7 +77,15 @@ void setup() {
 	// to be called again once hitting 600.
 
 	board.setTriggerOnEnvelope(600, 400, []() {
-		Serial.println("Threshold Reached!");
+		Serial.println("Second Threshold Reached!");
+	});
+
+	// Both triggers above stay active. Up to MAX_TRIGGERS can be added, each with its own
+	// channel, threshold, hysteresis and edge. This one fires when the envelope drops back
+	// to 200 (after having been above 250), without pulsing the relay.
+
+	board.addTrigger(A0, 200, 50, FALLING_EDGE, []() {
+		Serial.println("Relaxed!");
 	});
 
 }
@@ -95,6 +95,17 @@ void setup() {
 	});
 
 	// **************************************** //
+	// OPTION 5 //
+
+	// The servo is moved by the sample interrupt once per servo frame (20ms). It follows
+	// the envelope, and can be tuned to move slower or ignore smaller changes //
+
+	board.startServo();
+	board.setServoSlewRate(180);    // At most 180 degrees per second
+	board.setServoDeadband(3);      // Ignore changes of 3 degrees or less
+	board.setServoInput(SERVO_ENVELOPE_INPUT);
+
+	// **************************************** //
 
 }
 
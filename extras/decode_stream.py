@@ -0,0 +1,135 @@
+#!/usr/bin/env python3
+"""
+Decoder for the binary stream sent by NeuroBoard::startStreaming().
+
+Every scanned channel takes two bytes per sample, 7 bits each, high bits
+first. The first byte of each frame has its top bit set. All other bytes have
+it cleared, so the channel count is the number of byte pairs between two
+frame starts.
+
+Usage:
+    decode_stream.py /dev/ttyACM0               Print one frame per line
+    decode_stream.py /dev/ttyACM0 --rate        Print frames/second and bytes/second
+    decode_stream.py --benchmark [--seconds N]  Decode synthetic frames sent over a pty
+
+Requires pyserial for real ports (pip install pyserial).
+"""
+
+import argparse
+import os
+import sys
+import threading
+import time
+import tty
+
+
+class FrameDecoder:
+    """Turns a byte stream into frames (lists of samples, one per channel)."""
+
+    def __init__(self):
+        self.frame = None       # Samples of the frame being decoded, None until the first sync byte
+        self.high = None        # First byte of the sample being decoded
+        self.resyncs = 0        # Frames dropped because a byte went missing
+
+    def feed(self, data):
+        frames = []
+        for byte in data:
+            if byte & 0x80:
+                # Frame start. Anything half decoded means a byte was lost.
+                if self.frame is not None:
+                    if self.high is not None:
+                        self.resyncs += 1
+                    elif self.frame:
+                        frames.append(self.frame)
+                self.frame = []
+                self.high = byte & 0x7F
+            elif self.frame is None:
+                continue
+            elif self.high is None:
+                self.high = byte
+            else:
+                self.frame.append((self.high << 7) | byte)
+                self.high = None
+        return frames
+
+
+def encode_frame(samples):
+    out = bytearray()
+    for channel, sample in enumerate(samples):
+        out.append(((sample >> 7) & 0x7F) | (0x80 if channel == 0 else 0x00))
+        out.append(sample & 0x7F)
+    return bytes(out)
+
+
+def report(frames, total_bytes, start):
+    elapsed = time.time() - start
+    print("%.0f frames/s, %.0f bytes/s" % (frames / elapsed, total_bytes / elapsed))
+
+
+def decode_port(path, show_rate):
+    import serial
+    port = serial.Serial(path, 230400, timeout=0.1)
+    decoder = FrameDecoder()
+    frames, total_bytes, start = 0, 0, time.time()
+    try:
+        while True:
+            data = port.read(4096)
+            total_bytes += len(data)
+            for frame in decoder.feed(data):
+                frames += 1
+                if not show_rate:
+                    print("\t".join(str(sample) for sample in frame))
+            if show_rate and time.time() - start >= 1.0:
+                report(frames, total_bytes, start)
+                frames, total_bytes, start = 0, 0, time.time()
+    except KeyboardInterrupt:
+        pass
+
+
+def benchmark(seconds, channels):
+    """Measures decoding throughput over a pty, the same path a USB serial port takes."""
+    master, slave = os.openpty()
+    tty.setraw(master)
+    tty.setraw(slave)  # No line editing, 0x7F would otherwise be eaten as backspace
+    chunk = b"".join(encode_frame([(i * 37 + c) & 0x3FF for c in range(channels)]) for i in range(512))
+    stop = threading.Event()
+
+    def writer():
+        while not stop.is_set():
+            os.write(master, chunk)
+
+    thread = threading.Thread(target=writer, daemon=True)
+    thread.start()
+
+    decoder = FrameDecoder()
+    frames, total_bytes, start = 0, 0, time.time()
+    while time.time() - start < seconds:
+        data = os.read(slave, 4096)
+        total_bytes += len(data)
+        frames += len(decoder.feed(data))
+
+    stop.set()
+    report(frames, total_bytes, start)
+    print("%.0f samples/s at %d channel(s), %d resyncs" % (frames * channels / (time.time() - start), channels, decoder.resyncs))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("port", nargs="?", help="Serial port of the board")
+    parser.add_argument("--rate", action="store_true", help="Print throughput instead of samples")
+    parser.add_argument("--benchmark", action="store_true", help="Benchmark the decoder over a pty")
+    parser.add_argument("--seconds", type=float, default=5.0, help="Benchmark length")
+    parser.add_argument("--channels", type=int, default=1, help="Channels per frame for the benchmark")
+    args = parser.parse_args()
+
+    if args.benchmark:
+        benchmark(args.seconds, args.channels)
+    elif args.port:
+        decode_port(args.port, args.rate)
+    else:
+        parser.print_help()
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
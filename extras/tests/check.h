@@ -0,0 +1,31 @@
+/**
+ * Minimal checks shared by the host tests. A failed CHECK prints where it
+ * failed and makes the test exit with status 1.
+**/
+
+#pragma once
+
+#include <stdio.h>
+
+static int checkFailures = 0;
+
+#define CHECK(condition) do { \
+    if (!(condition)) { \
+        printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+        checkFailures++; \
+    } \
+} while (0)
+
+#define CHECK_EQUAL(actual, expected) do { \
+    long long checkActual = (long long)(actual); \
+    long long checkExpected = (long long)(expected); \
+    if (checkActual != checkExpected) { \
+        printf("%s:%d: %s is %lld, expected %lld\n", __FILE__, __LINE__, #actual, checkActual, checkExpected); \
+        checkFailures++; \
+    } \
+} while (0)
+
+static int checkResult(const char* name) {
+    printf("%s: %s\n", name, checkFailures ? "FAILED" : "passed");
+    return checkFailures ? 1 : 0;
+}
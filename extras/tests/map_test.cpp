@@ -0,0 +1,278 @@
+/**
+ * Host test and benchmark of the servo and LED bar mappings in NeuroDSP.hpp.
+ *
+ * MapKernel is checked against the exact mapping, rounded to the nearest
+ * value, and against Arduino's map() for every servo sensitivity and each of
+ * the three mappings the servo code uses, OPEN_MODE's descending one too. The
+ * PROGMEM tables of TABLE_MAPPING must stay within one of the exact mapping.
+ *
+ * Build and run with `make -C extras/tests`, `make -C extras/tests bench`
+ * adds the time per call of map(), the old fasterMap(), MapKernel and a table
+ * lookup.
+**/
+
+#include "NeuroDSP.hpp"
+#include "check.h"
+
+#include <chrono>
+#include <stdlib.h>
+
+static const int sensitivities[] = {200, 350, 520, 680, 840, 1024};  // servoSensitivity()
+static const uint8_t tableSize = 128;                                 // MAP_TABLE_SIZE
+
+/**
+ * The mappings of the servo code, from fromLow up to the sensitivity.
+**/
+struct Mapping {
+    const char* name;
+    int fromLow;
+    int toLow;
+    int toHigh;
+};
+
+static const Mapping mappings[] = {
+    {"OPEN_MODE", 40, 190, 105},
+    {"CLOSED_MODE", 120, 105, 190},
+    {"LED bar", 30, 0, 8},           // MAX_LEDS on the Leonardo
+};
+
+/**
+ * Arduino's map(), truncating.
+**/
+static long arduinoMap(long value, long fromLow, long fromHigh, long toLow, long toHigh) {
+    return (value - fromLow) * (toHigh - toLow) / (fromHigh - fromLow) + toLow;
+}
+
+/**
+ * The mapping the library used before MapKernel. Descending output ranges
+ * always return toLow.
+**/
+static long fasterMap(long value, long fromLow, long fromHigh, long toLow, long toHigh) {
+
+    long first = value - fromLow;
+    long second = toHigh - toLow;
+    long combined = 0;
+    while (second > 0) {
+        combined = combined + first;
+        second = second - 1;
+    }
+    long third = fromHigh - fromLow;
+    long count = 0;
+    while (combined >= third) {
+        combined = combined - third;
+        count = count + 1;
+    }
+    count = count + toLow;
+    return count;
+
+}
+
+/**
+ * True if mapped is within half a step of the exact mapping of value, checked
+ * in integers: |mapped - toLow - (value - fromLow) * to / from| <= 1 / 2.
+**/
+static bool nearest(long mapped, long value, long fromLow, long fromHigh, long toLow, long toHigh) {
+    long from = fromHigh - fromLow;
+    long error = 2 * ((mapped - toLow) * from - (value - fromLow) * (toHigh - toLow));
+    return labs(error) <= labs(from);
+}
+
+/**
+ * Every reading the servo code can pass at every sensitivity maps to the
+ * nearest value, hits both ends exactly and is at most one from map().
+**/
+static void testKernelSensitivities(void) {
+
+    for (const Mapping& m : mappings) {
+        for (int saturation : sensitivities) {
+
+            MapKernel kernel(m.fromLow, saturation, m.toLow, m.toHigh);
+            long worst = 0;
+
+            for (int value = m.fromLow; value <= saturation; value++) {
+                int16_t mapped = kernel.map(value);
+                CHECK(nearest(mapped, value, m.fromLow, saturation, m.toLow, m.toHigh));
+                long difference = labs(mapped - arduinoMap(value, m.fromLow, saturation, m.toLow, m.toHigh));
+                if (difference > worst) worst = difference;
+            }
+
+            CHECK_EQUAL(kernel.map(m.fromLow), m.toLow);
+            CHECK_EQUAL(kernel.map(saturation), m.toHigh);
+            CHECK(worst <= 1);
+
+        }
+    }
+
+}
+
+/**
+ * Within one of the exact mapping, the nearest value where the from range
+ * is short enough for the slope's precision.
+**/
+static bool close(long mapped, long value, long fromLow, long fromHigh, long toLow, long toHigh) {
+    long from = fromHigh - fromLow;
+    long error = (mapped - toLow) * from - (value - fromLow) * (toHigh - toLow);
+    long bits = (labs(toHigh - toLow) < 128) ? 24 : 16;
+    if (from * from < (1L << bits)) return nearest(mapped, value, fromLow, fromHigh, toLow, toHigh);
+    return labs(error) < labs(from);
+}
+
+/**
+ * Random ranges either way round, up to the 32767 span MapKernel allows, and
+ * the angle to pulse width mapping of the servo.
+**/
+static void testKernelRanges(void) {
+
+    uint32_t state = 2463534242UL;
+
+    for (uint32_t i = 0; i < 20000; i++) {
+
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+
+        // Short and long ranges, narrow and wide outputs //
+
+        long fromSpan = (i & 1) ? 8192 : 30000;
+        long toSpan = (i & 2) ? 250 : 30000;
+        long fromLow = (long)(state % 2048) - 1024;
+        long fromHigh = fromLow + (long)((state >> 11) % fromSpan) - fromSpan / 2;
+        long toLow = (long)((state >> 7) % 2048) - 1024;
+        long toHigh = toLow + (long)((state >> 17) % toSpan) - toSpan / 2;
+        if (fromHigh == fromLow) continue;
+
+        MapKernel kernel(fromLow, fromHigh, toLow, toHigh);
+        long step = labs(fromHigh - fromLow) / 64 + 1;
+        long direction = (fromHigh > fromLow) ? step : -step;
+
+        for (long value = fromLow; (direction > 0) ? value <= fromHigh : value >= fromHigh; value += direction) {
+            CHECK(close(kernel.map(value), value, fromLow, fromHigh, toLow, toHigh));
+        }
+        CHECK_EQUAL(kernel.map(fromHigh), toHigh);
+
+    }
+
+    MapKernel angleToPulse(0, 180, 544, 2400);  // MIN_PULSE_WIDTH, MAX_PULSE_WIDTH
+    for (int angle = 0; angle <= 180; angle++) {
+        CHECK(nearest(angleToPulse.map(angle), angle, 0, 180, 544, 2400));
+    }
+
+    // An empty from range maps everything to toLow //
+
+    MapKernel empty(100, 100, 5, 50);
+    CHECK_EQUAL(empty.map(100), 5);
+
+}
+
+/**
+ * The reference fasterMap() is map() on ascending ranges and stuck at toLow
+ * on descending ones, which is why OPEN_MODE never moved with it.
+**/
+static void testFasterMap(void) {
+
+    for (int value = 120; value <= 680; value++) {
+        CHECK_EQUAL(fasterMap(value, 120, 680, 105, 190), arduinoMap(value, 120, 680, 105, 190));
+    }
+    CHECK_EQUAL(fasterMap(1024, 40, 1024, 190, 105), 190);
+
+}
+
+/**
+ * Every reading, constrained and looked up the way lookupReading does, is
+ * within one of the exact mapping for every sensitivity. That keeps the
+ * tables well inside the servo's 5 degree dead zone.
+**/
+static void testTables(void) {
+
+    for (const Mapping& m : mappings) {
+        for (int saturation : sensitivities) {
+
+            MapTable<tableSize> table = mapTable<tableSize>(m.fromLow, saturation, m.toLow, m.toHigh);
+            long from = saturation - m.fromLow;
+            long worst = 0;
+
+            CHECK(((from >> table.shift) < tableSize));
+
+            for (int reading = 0; reading <= 1023; reading++) {
+                int value = (reading < m.fromLow) ? m.fromLow : (reading > saturation) ? saturation : reading;
+                long mapped = table.values[(value - m.fromLow) >> table.shift];
+                long error = labs((mapped - m.toLow) * from - (long)(value - m.fromLow) * (m.toHigh - m.toLow));
+                if (error > worst) worst = error;
+            }
+
+            if (worst > from) printf("%s table at %d is off by %.2f\n", m.name, saturation, (double)worst / from);
+            CHECK(worst <= from);
+
+        }
+    }
+
+    // Short ranges get an entry per input and map exactly //
+
+    MapTable<tableSize> exact = mapTable<tableSize>(120, 200, 105, 190);
+    CHECK_EQUAL(exact.shift, 0);
+    for (int value = 120; value <= 200; value++) {
+        CHECK(nearest(exact.values[value - 120], value, 120, 200, 105, 190));
+    }
+
+}
+
+/**
+ * Host time per call of one way of mapping over the CLOSED_MODE readings of
+ * a sensitivity, like the MapBenchmark example does on the board.
+**/
+template <typename MAP>
+static double timeMapping(const int& saturation, MAP mapping) {
+
+    volatile long sink = 0;
+    const uint32_t rounds = 2000;
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t round = 0; round < rounds; round++) {
+        for (int value = 120; value <= saturation; value++) sink = mapping(value);
+    }
+    auto end = std::chrono::steady_clock::now();
+    (void)sink;
+
+    return std::chrono::duration<double, std::nano>(end - start).count() / rounds / (saturation - 120 + 1);
+
+}
+
+/**
+ * Cost of each way of mapping for every sensitivity. These are host times,
+ * they rank the backends but say nothing absolute about AVR cycles; the
+ * MapBenchmark example measures those on the board.
+**/
+static void benchmark(void) {
+
+    printf("%-12s %10s %12s %12s %12s\n", "saturation", "map()", "fasterMap()", "MapKernel", "table");
+
+    for (int saturation : sensitivities) {
+
+        MapKernel kernel(120, saturation, 105, 190);
+        MapTable<tableSize> table = mapTable<tableSize>(120, saturation, 105, 190);
+
+        double mapTime = timeMapping(saturation, [&](int value) { return arduinoMap(value, 120, saturation, 105, 190); });
+        double fasterTime = timeMapping(saturation, [&](int value) { return fasterMap(value, 120, saturation, 105, 190); });
+        double kernelTime = timeMapping(saturation, [&](int value) { return (long)kernel.map(value); });
+        double tableTime = timeMapping(saturation, [&](int value) { return (long)table.values[(value - 120) >> table.shift]; });
+
+        printf("%-12d %7.2f ns %9.2f ns %9.2f ns %9.2f ns\n", saturation, mapTime, fasterTime, kernelTime, tableTime);
+
+    }
+
+}
+
+int main(int argc, char** argv) {
+
+    (void)argv;
+
+    testKernelSensitivities();
+    testKernelRanges();
+    testFasterMap();
+    testTables();
+
+    if (argc > 1) benchmark();
+
+    return checkResult("map_test");
+
+}
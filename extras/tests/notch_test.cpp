@@ -0,0 +1,150 @@
+/**
+ * Host test of the mains notch and the NOTCH_AUTO detector in NeuroDSP.hpp.
+ *
+ * Runs synthetic hum through Biquad and MainsDetector over the whole range of
+ * sample rates the board can run at, from the 250 Hz default up to
+ * MAX_SAMPLE_RATE on a 16 MHz Leonardo.
+ *
+ * Build and run with `make -C extras/tests`.
+**/
+
+#include "NeuroDSP.hpp"
+#include "check.h"
+
+#include <initializer_list>
+#include <math.h>
+#include <stdlib.h>
+
+static const float rates[] = {250, 1000, 5000, 10000, 20000, 30000, 38461};
+static const float bandwidth = 4;   // NOTCH_BANDWIDTH
+
+/**
+ * Sine of amplitude around 512, like a biased ADC reading.
+**/
+static int16_t tone(const float& frequency, const float& amplitude, const float& rate, const unsigned long& n) {
+    return (int16_t)lrintf(512 + amplitude * sinf(2 * (float)M_PI * frequency * n / rate));
+}
+
+/**
+ * Peak to peak output over the last half second, after the notch has settled.
+**/
+static int16_t settledPeakToPeak(const float& frequency, const float& amplitude, const float& rate, const uint8_t& mains) {
+
+    BiquadCoefficients k = notchCoefficients(mains, rate, bandwidth);
+    Biquad notch;
+    unsigned long settle = (unsigned long)(rate * 2);
+    unsigned long total = settle + (unsigned long)(rate / 2);
+    int16_t low = 0x7FFF;
+    int16_t high = -0x7FFF;
+
+    for (unsigned long n = 0; n < total; n++) {
+        int16_t y = notch.process(tone(frequency, amplitude, rate, n), k);
+        if (n < settle) continue;
+        if (y < low) low = y;
+        if (y > high) high = y;
+    }
+
+    return high - low;
+
+}
+
+/**
+ * 400 p-p of hum must come out as a couple of counts of rounding noise.
+**/
+static void testDepth(void) {
+    for (float rate : rates) {
+        for (uint8_t mains : {50, 60}) {
+            int16_t left = settledPeakToPeak(mains, 200, rate, mains);
+            if (left > 2) printf("%u Hz notch at %.0f Hz leaves %d p-p\n", mains, rate, left);
+            CHECK(left <= 2);
+        }
+    }
+}
+
+/**
+ * Signals away from the notch keep their amplitude, and DC stays put.
+**/
+static void testPassband(void) {
+    for (float rate : rates) {
+        CHECK(abs(settledPeakToPeak(20, 200, rate, 50) - 400) <= 8);
+        CHECK(settledPeakToPeak(0, 0, rate, 60) <= 1);
+    }
+}
+
+/**
+ * Coefficients fill 16 bits at every rate instead of saturating, and rates
+ * that can't hold the notch are refused.
+**/
+static void testCoefficients(void) {
+
+    for (float rate : rates) {
+        BiquadCoefficients k = notchCoefficients(50, rate, bandwidth);
+        int16_t largest = k.zero;
+        if (k.pole1 > largest) largest = k.pole1;
+        if (k.pole2 > largest) largest = k.pole2;
+        if (abs(k.gain) > largest) largest = abs(k.gain);
+        CHECK(largest >= 16384);
+        CHECK(k.pole1 > 0 && k.pole2 > 0 && k.zero > 0);
+        CHECK(notchUsable(50, rate, bandwidth));
+        CHECK(notchUsable(60, rate, bandwidth));
+    }
+
+    CHECK(!notchUsable(60, 120, bandwidth));
+    CHECK(!notchUsable(50, 100, bandwidth));
+
+    static_assert(notchUsable(60, 38461, 4), "Notch must fit at MAX_SAMPLE_RATE");
+
+}
+
+static void testMultiplyQ13(void) {
+
+    uint32_t state = 2463534242UL;
+
+    for (uint32_t i = 0; i < 1000000; i++) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        int16_t coefficient = (int16_t)(state & 0x7FFF) - 16384;
+        int32_t value = (int32_t)(state >> 4) - (1L << 27);
+        CHECK_EQUAL(multiplyQ13(coefficient, value), ((int64_t)coefficient * value) >> 13);
+    }
+
+}
+
+/**
+ * NOTCH_AUTO picks the right frequency at every rate. Full scale hum is the
+ * worst case for the Goertzel state, the sanitizer catches any overflow.
+**/
+static void testDetector(void) {
+    for (float rate : rates) {
+        for (uint8_t mains : {50, 60}) {
+            for (float amplitude : {300.0f, 511.0f, 20.0f}) {
+
+                MainsDetector detector;
+                CHECK(detector.start(rate, 250, 512));
+
+                unsigned long n = 0;
+                while (!detector.push(tone(mains, amplitude, rate, n))) n++;
+
+                CHECK_EQUAL(detector.mains(), mains);
+                CHECK(n + 1 >= (unsigned long)(rate / 4) - (1UL << decimationShift(rate, MAINS_DETECTOR_RATE)));
+
+            }
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+
+    (void)argc;
+    (void)argv;
+
+    testDepth();
+    testPassband();
+    testCoefficients();
+    testMultiplyQ13();
+    testDetector();
+
+    return checkResult("notch_test");
+
+}
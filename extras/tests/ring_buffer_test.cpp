@@ -0,0 +1,288 @@
+/**
+ * Host test and benchmark of NeuroRingBuffer.hpp.
+ *
+ * The sample ISR is simulated by a producer that runs a random number of
+ * times between consumer calls, the same places a real interrupt can land
+ * relative to the critical sections. Checks ordering, the overrun accounting
+ * of both policies and the wrap of the 8 bit head and tail counters.
+ *
+ * Build and run with `make -C extras/tests`.
+**/
+
+#include "NeuroRingBuffer.hpp"
+#include "check.h"
+
+#include <chrono>
+
+// Small xorshift, so runs are repeatable //
+
+static uint32_t randomState = 2463534242UL;
+
+static uint32_t nextRandom(void) {
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+    return randomState;
+}
+
+/**
+ * Pushes and pops far more than 256 elements one at a time, so head and
+ * tail wrap many times, at every fill level from empty to full.
+**/
+template <uint8_t SIZE>
+static void testWraparound(void) {
+
+    StaticRingBuffer<uint16_t, SIZE, DROP_NEWEST> ring;
+    uint16_t pushed = 0;
+    uint16_t popped = 0;
+
+    for (uint16_t round = 0; round < 2000; round++) {
+
+        uint8_t fill = round % (SIZE + 1);
+        for (uint8_t i = 0; i < fill; i++) CHECK(ring.push(pushed++));
+        CHECK_EQUAL(ring.available(), fill);
+        if (fill == SIZE) CHECK(!ring.push(0xFFFF));
+
+        uint16_t value = 0;
+        while (ring.pop(value)) CHECK_EQUAL(value, popped++);
+        CHECK(ring.empty());
+
+    }
+
+    CHECK_EQUAL(popped, pushed);
+    CHECK_EQUAL(ring.takeOverruns(), 2000 / (SIZE + 1));
+
+}
+
+static void testOverwriteOldest(void) {
+
+    StaticRingBuffer<uint16_t, 8, OVERWRITE_OLDEST> ring;
+
+    for (uint16_t i = 0; i < 8; i++) CHECK(ring.push(i));
+    for (uint16_t i = 8; i < 13; i++) CHECK(!ring.push(i));
+
+    CHECK_EQUAL(ring.available(), 8);
+    CHECK_EQUAL(ring.last(), 12);
+    CHECK_EQUAL(ring.takeOverruns(), 5);
+    CHECK_EQUAL(ring.takeOverruns(), 0);
+
+    // The newest 8 are kept, oldest first //
+
+    uint16_t value = 0;
+    for (uint16_t expected = 5; expected < 13; expected++) {
+        CHECK(ring.pop(value));
+        CHECK_EQUAL(value, expected);
+    }
+    CHECK(!ring.pop(value));
+
+}
+
+static void testDropNewest(void) {
+
+    StaticRingBuffer<uint16_t, 8, DROP_NEWEST> ring;
+
+    for (uint16_t i = 0; i < 8; i++) CHECK(ring.push(i));
+    for (uint16_t i = 8; i < 13; i++) CHECK(!ring.push(i));
+
+    CHECK_EQUAL(ring.available(), 8);
+    CHECK_EQUAL(ring.last(), 7);
+    CHECK_EQUAL(ring.takeOverruns(), 5);
+
+    // The oldest 8 are kept //
+
+    uint16_t value = 0;
+    for (uint16_t expected = 0; expected < 8; expected++) {
+        CHECK(ring.pop(value));
+        CHECK_EQUAL(value, expected);
+    }
+    CHECK(!ring.pop(value));
+
+}
+
+static void testOverrunSaturates(void) {
+
+    StaticRingBuffer<uint8_t, 2, DROP_NEWEST> ring;
+    for (uint32_t i = 0; i < 70000; i++) ring.push(1);
+    CHECK_EQUAL(ring.takeOverruns(), 0xFFFF);
+
+}
+
+static void testReadAcrossWrap(void) {
+
+    StaticRingBuffer<uint16_t, 8> ring;
+    uint16_t out[8];
+
+    // Move the indices so the next 8 elements straddle the end of storage //
+
+    for (uint16_t i = 0; i < 6; i++) ring.push(i);
+    CHECK_EQUAL(ring.read(out, 8), 6);
+    for (uint16_t i = 0; i < 8; i++) ring.push(100 + i);
+
+    CHECK_EQUAL(ring.read(out, 3), 3);
+    for (uint16_t i = 0; i < 3; i++) CHECK_EQUAL(out[i], 100 + i);
+    CHECK_EQUAL(ring.read(out, 8), 5);
+    for (uint16_t i = 0; i < 5; i++) CHECK_EQUAL(out[i], 103 + i);
+    CHECK_EQUAL(ring.read(out, 8), 0);
+
+}
+
+static void testPeekCommit(void) {
+
+    StaticRingBuffer<uint16_t, 8> ring;
+    RingBuffer<uint16_t>::Span spans[2];
+    uint16_t value = 0;
+
+    for (uint16_t i = 0; i < 5; i++) ring.push(i);
+    for (uint16_t i = 0; i < 5; i++) ring.pop(value);
+    for (uint16_t i = 0; i < 6; i++) ring.push(10 + i);
+
+    // Storage positions 5, 6, 7 then 0, 1, 2 //
+
+    CHECK_EQUAL(ring.peek(spans), 6);
+    CHECK_EQUAL(spans[0].length, 3);
+    CHECK_EQUAL(spans[1].length, 3);
+    CHECK_EQUAL(spans[0].data[0], 10);
+    CHECK_EQUAL(spans[1].data[2], 15);
+    CHECK_EQUAL(ring.commit(4), 0);
+    CHECK_EQUAL(ring.available(), 2);
+
+    // The producer laps the consumer while it holds the spans //
+
+    CHECK_EQUAL(ring.peek(spans), 2);
+    for (uint16_t i = 0; i < 9; i++) ring.push(20 + i);
+    CHECK_EQUAL(ring.commit(2), 2);
+    CHECK(ring.pop(value));
+    CHECK_EQUAL(value, 21);
+
+}
+
+/**
+ * Consumer in loop() against a producer in the ISR. Every element is a
+ * sequence number, so each gap the consumer sees must be paid for by an
+ * overrun, and nothing may arrive out of order.
+**/
+template <OverrunPolicy POLICY>
+static void testSimulatedISR(void) {
+
+    StaticRingBuffer<uint32_t, 32, POLICY> ring;
+    uint32_t produced = 0;
+    uint32_t consumed = 0;
+    uint32_t skipped = 0;
+    uint32_t lost = 0;
+    uint32_t expected = 0;
+    uint32_t out[16];
+    typename RingBuffer<uint32_t, POLICY>::Span spans[2];
+
+    for (uint32_t step = 0; step < 200000; step++) {
+
+        // ISR: a burst of 0 - 7 ticks //
+
+        uint32_t burst = nextRandom() & 7;
+        for (uint32_t i = 0; i < burst; i++) ring.push(produced++);
+
+        // loop(): one of the three ways of reading //
+
+        uint32_t value = 0;
+        uint8_t count = 0;
+
+        switch (nextRandom() % 3) {
+
+            case 0:
+                if (ring.pop(value)) {
+                    out[0] = value;
+                    count = 1;
+                }
+                break;
+
+            case 1:
+                count = ring.read(out, 1 + nextRandom() % 16);
+                break;
+
+            default:
+                count = ring.peek(spans);
+                if (count > 16) count = 16;
+                for (uint8_t i = 0; i < count; i++) {
+                    out[i] = (i < spans[0].length) ? spans[0].data[i] : spans[1].data[i - spans[0].length];
+                }
+                if (ring.commit(count)) count = 0; // Overwritten while held, values can't be trusted
+                break;
+
+        }
+
+        for (uint8_t i = 0; i < count; i++) {
+            CHECK(out[i] >= expected);
+            skipped += out[i] - expected;
+            expected = out[i] + 1;
+            consumed++;
+        }
+
+        lost += ring.takeOverruns();
+
+    }
+
+    // Whatever is still queued is the tail of the sequence //
+
+    uint32_t value = 0;
+    while (ring.pop(value)) {
+        CHECK(value >= expected);
+        skipped += value - expected;
+        expected = value + 1;
+        consumed++;
+    }
+    skipped += produced - expected;
+
+    CHECK(lost > 0);
+    CHECK_EQUAL(consumed + skipped, produced);
+    if (POLICY == DROP_NEWEST) CHECK_EQUAL(skipped, lost);
+    if (POLICY == OVERWRITE_OLDEST) CHECK(skipped >= lost); // Commits that were overwritten skip too
+
+}
+
+static void benchmark(void) {
+
+    StaticRingBuffer<int16_t, 32> overwrite;
+    StaticRingBuffer<int16_t, 32, DROP_NEWEST> drop;
+    const uint32_t rounds = 20000000;
+    volatile int16_t sink = 0;
+    int16_t value = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < rounds; i++) {
+        overwrite.push(i);
+        overwrite.pop(value);
+        sink = value;
+    }
+    auto middle = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < rounds; i++) {
+        drop.push(i);
+        drop.pop(value);
+        sink = value;
+    }
+    auto end = std::chrono::steady_clock::now();
+    (void)sink;
+
+    printf("push + pop, OVERWRITE_OLDEST: %.2f ns\n", std::chrono::duration<double, std::nano>(middle - start).count() / rounds);
+    printf("push + pop, DROP_NEWEST:      %.2f ns\n", std::chrono::duration<double, std::nano>(end - middle).count() / rounds);
+
+}
+
+int main(int argc, char** argv) {
+
+    (void)argv;
+
+    testWraparound<1>();
+    testWraparound<8>();
+    testWraparound<128>();
+    testOverwriteOldest();
+    testDropNewest();
+    testOverrunSaturates();
+    testReadAcrossWrap();
+    testPeekCommit();
+    testSimulatedISR<OVERWRITE_OLDEST>();
+    testSimulatedISR<DROP_NEWEST>();
+
+    if (argc > 1) benchmark();
+
+    return checkResult("ring_buffer_test");
+
+}
@@ -0,0 +1,11 @@
+/**
+ * Host stand-in for avr-libc's util/atomic.h. There are no interrupts on the
+ * host, the simulated ISR only ever runs between two calls, so the blocks
+ * just run once.
+**/
+
+#pragma once
+
+#define ATOMIC_RESTORESTATE 0
+#define ATOMIC_FORCEON 0
+#define ATOMIC_BLOCK(type) for (int atomicOnce = 1; atomicOnce; atomicOnce = 0)
@@ -0,0 +1,339 @@
+/**
+ * Host trace harness for the sample path stages in NeuroDSP.hpp: runChain
+ * filter chains, CicDecimator and SlidingWindow.
+ *
+ * Synthetic traces (DC, hum, EMG like bursts, random noise) are run through
+ * each stage and the outputs are checked against straightforward double
+ * precision or brute force versions of the same processing.
+ *
+ * A recorded trace, one reading per line (the Serial Plotter output of a
+ * sketch that prints board.getNewSample(), for instance), can be passed as
+ * an argument. Each reading is then printed with the outputs of every stage,
+ * tab separated, ready to plot.
+ *
+ * Build and run with `make -C extras/tests`, `make -C extras/tests bench`
+ * adds the time each stage of the chain takes per sample.
+**/
+
+#include "NeuroDSP.hpp"
+#include "check.h"
+
+#include <chrono>
+#include <initializer_list>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+static const unsigned long RATE = 5000;
+
+typedef Chain<HighPass<RATE, 20>, Notch<RATE, 50>, Rectify<>, LowPass<RATE, 10>> EmgChain;
+
+// Small xorshift, so runs are repeatable //
+
+static uint32_t randomState = 2463534242UL;
+
+static uint32_t nextRandom(void) {
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+    return randomState;
+}
+
+/**
+ * Biased ADC reading with 50 Hz hum, a 150 Hz burst between start and end
+ * seconds and a little noise, clamped to 10 bits.
+**/
+static std::vector<int16_t> emgTrace(const float& seconds, const float& start, const float& end) {
+
+    std::vector<int16_t> trace;
+
+    for (unsigned long n = 0; n < seconds * RATE; n++) {
+        float t = (float)n / RATE;
+        float value = 512 + 100 * sinf(2 * (float)M_PI * 50 * t) + (int)(nextRandom() % 5) - 2;
+        if (t >= start && t < end) value += 200 * sinf(2 * (float)M_PI * 150 * t);
+        long reading = lrintf(value);
+        trace.push_back((reading < 0) ? 0 : (reading > 1023) ? 1023 : reading);
+    }
+
+    return trace;
+
+}
+
+/**
+ * EmgChain in double precision: the same single pole time constants, an ideal
+ * notch with the same poles and zeros.
+**/
+class ReferenceChain {
+
+    public:
+
+        ReferenceChain() : highPass(0), lowPass(0), x1(0), x2(0), y1(0), y2(0) {};
+
+        double process(const double& x) {
+
+            highPass += (x - highPass) / (1 << LowPass<RATE, 20>::shift);
+            double centered = x - highPass;
+
+            double w = 2 * M_PI * 50 / RATE;
+            double r = 1 - M_PI * 4 / RATE;
+            double gain = (1 - 2 * r * cos(w) + r * r) / (2 - 2 * cos(w));
+            double notched = gain * (centered - 2 * cos(w) * x1 + x2) + 2 * r * cos(w) * y1 - r * r * y2;
+            x2 = x1;
+            x1 = centered;
+            y2 = y1;
+            y1 = notched;
+
+            lowPass += (fabs(notched) - lowPass) / (1 << LowPass<RATE, 10>::shift);
+            return lowPass;
+
+        }
+
+    private:
+
+        double highPass, lowPass;
+        double x1, x2, y1, y2;
+
+};
+
+/**
+ * runChain follows the double precision chain, the envelope is low at rest
+ * and close to the mean of the rectified burst (2 / PI of its amplitude)
+ * during it.
+**/
+static void testChain(void) {
+
+    std::vector<int16_t> trace = emgTrace(4, 2, 3);
+    ReferenceChain reference;
+    double worst = 0;
+
+    for (size_t n = 0; n < trace.size(); n++) {
+
+        int16_t output = runChain<EmgChain>(0, trace[n]);
+        double expected = reference.process(trace[n]);
+        float t = (float)n / RATE;
+
+        if (t > 1 && fabs(output - expected) > worst) worst = fabs(output - expected);
+        if (t > 1.5f && t < 2) CHECK(output < 10);
+        if (t > 2.5f && t < 3) CHECK(output > 110 && output < 145);
+
+    }
+
+    CHECK(worst <= 3);
+
+}
+
+/**
+ * Each of the CHANNELS slots has its own state, slots past it pass through.
+**/
+static void testChainSlots(void) {
+
+    std::vector<int16_t> burst = emgTrace(2, 1, 2);
+    std::vector<int16_t> rest = emgTrace(2, 2, 2);
+
+    for (size_t n = 0; n < burst.size(); n++) {
+        int16_t active = runChain<EmgChain, 2>(0, burst[n]);
+        int16_t quiet = runChain<EmgChain, 2>(1, rest[n]);
+        CHECK_EQUAL((runChain<EmgChain, 2>(2, rest[n])), rest[n]);
+        if (n > 1.5f * RATE) {
+            CHECK(active > 110);
+            CHECK(quiet < 10);
+        }
+    }
+
+}
+
+/**
+ * ORDER box filters of length factor in 64 bits, sampled at the end of each
+ * block, against CicDecimator. They must match exactly, also long after the
+ * 32 bit integrators have wrapped.
+**/
+template <uint8_t ORDER>
+static void testDecimator(const uint8_t& factor, const uint32_t& length, const bool& fullScale) {
+
+    CicDecimator<ORDER> decimator;
+    decimator.setFactor(factor);
+
+    std::vector<int64_t> stage[ORDER + 1];
+    uint8_t shift = 0;
+    for (uint8_t f = factor; f > 1; f >>= 1) shift += ORDER;
+    uint32_t outputs = 0;
+
+    for (uint32_t n = 0; n < length; n++) {
+
+        int16_t sample = fullScale ? 1023 : (int16_t)(nextRandom() % 2048) - 1024;
+        stage[0].push_back(sample);
+
+        for (uint8_t i = 1; i <= ORDER; i++) {
+            int64_t sum = 0;
+            for (uint32_t j = 0; j < factor && j <= n; j++) sum += stage[i - 1][n - j];
+            stage[i].push_back(sum);
+        }
+
+        int16_t output = 0;
+        bool produced = decimator.push(sample, output);
+        CHECK_EQUAL(produced, (n + 1) % factor == 0);
+
+        // The first ORDER outputs still see the zeros the filter started from //
+
+        if (produced && ++outputs > ORDER) CHECK_EQUAL(output, stage[ORDER][n] >> shift);
+
+    }
+
+    CHECK_EQUAL(outputs, length / factor);
+
+}
+
+/**
+ * Window statistics against a brute force pass over the last length samples.
+**/
+template <uint8_t SIZE>
+static void testWindow(void) {
+
+    SlidingWindow<SIZE> window;
+    std::vector<int16_t> trace;
+
+    for (int length : {1, 2, 3, SIZE / 2 + 1, SIZE - 1, (int)SIZE}) {
+
+        if (length < 1 || length > SIZE) continue;
+        window.setLength(length);
+        trace.clear();
+
+        for (uint32_t n = 0; n < 3000; n++) {
+
+            // Runs of equal samples and slow ramps as well as noise, they are the hard cases for the queues //
+
+            int16_t sample;
+            switch ((n / 200) % 3) {
+                case 0: sample = (int16_t)(nextRandom() % 2048) - 1024; break;
+                case 1: sample = (nextRandom() % 4) ? 300 : -300; break;
+                default: sample = (int16_t)(n % 100) * 10 - 500; break;
+            }
+
+            window.push(sample);
+            trace.push_back(sample);
+
+            size_t count = (trace.size() < (size_t)length) ? trace.size() : length;
+            int32_t sum = 0;
+            uint32_t sumSquares = 0;
+            int16_t low = 0x7FFF;
+            int16_t high = -0x7FFF;
+            for (size_t i = trace.size() - count; i < trace.size(); i++) {
+                sum += trace[i];
+                sumSquares += (uint32_t)(trace[i] * trace[i]);
+                if (trace[i] < low) low = trace[i];
+                if (trace[i] > high) high = trace[i];
+            }
+
+            CHECK_EQUAL(window.getCount(), count);
+            CHECK_EQUAL(window.getSum(), sum);
+            CHECK_EQUAL(window.getSumSquares(), sumSquares);
+            CHECK_EQUAL(window.getMin(), low);
+            CHECK_EQUAL(window.getMax(), high);
+
+        }
+
+    }
+
+}
+
+/**
+ * Prints a recorded trace with the output of each stage, tab separated.
+**/
+static int runRecording(const char* path) {
+
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        printf("Can't open %s\n", path);
+        return 1;
+    }
+
+    CicDecimator<3> decimator;
+    SlidingWindow<64> window;
+    decimator.setFactor(8);
+    window.setLength(64);
+    int16_t decimated = 0;
+    int reading;
+
+    printf("reading\tchain\tdecimated\tmean\tmin\tmax\n");
+
+    while (fscanf(file, "%d", &reading) == 1) {
+        int16_t chain = runChain<EmgChain>(0, reading);
+        decimator.push(reading, decimated);
+        window.push(reading);
+        printf("%d\t%d\t%d\t%ld\t%d\t%d\n", reading, chain, decimated,
+               (long)(window.getSum() / window.getCount()), window.getMin(), window.getMax());
+    }
+
+    fclose(file);
+    return 0;
+
+}
+
+/**
+ * Host time per sample of one stage over a trace, fed the output of the
+ * stages before it the way the chain would.
+**/
+template <typename STAGE>
+static void timeStage(const char* name, const std::vector<int16_t>& trace) {
+
+    STAGE stage;
+    volatile int16_t sink = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t n = 0; n < trace.size(); n++) sink = stage.process(trace[n]);
+    auto end = std::chrono::steady_clock::now();
+    (void)sink;
+
+    printf("%-28s %6.2f ns per sample\n", name, std::chrono::duration<double, std::nano>(end - start).count() / trace.size());
+
+}
+
+/**
+ * Cost of each stage of EmgChain and of the whole chain. These are host
+ * times, they rank the stages but say nothing absolute about AVR cycles;
+ * getISRCycles measures those on the board.
+**/
+static void benchmark(void) {
+
+    std::vector<int16_t> trace = emgTrace(20, 5, 15);
+    std::vector<int16_t> centered, notched, rectified;
+    HighPass<RATE, 20> highPass;
+    Notch<RATE, 50> notch;
+    Rectify<> rectify;
+
+    for (size_t n = 0; n < trace.size(); n++) {
+        centered.push_back(highPass.process(trace[n]));
+        notched.push_back(notch.process(centered.back()));
+        rectified.push_back(rectify.process(notched.back()));
+    }
+
+    timeStage<HighPass<RATE, 20>>("HighPass<5000, 20>", trace);
+    timeStage<Notch<RATE, 50>>("Notch<5000, 50>", centered);
+    timeStage<Rectify<>>("Rectify<>", notched);
+    timeStage<LowPass<RATE, 10>>("LowPass<5000, 10>", rectified);
+    timeStage<EmgChain>("EmgChain", trace);
+
+}
+
+int main(int argc, char** argv) {
+
+    if (argc > 1 && strcmp(argv[1], "bench") != 0) return runRecording(argv[1]);
+
+    testChain();
+    testChainSlots();
+    testDecimator<1>(1, 1000, false);
+    testDecimator<1>(16, 4000, false);
+    testDecimator<2>(4, 4000, false);
+    testDecimator<3>(2, 4000, false);
+    testDecimator<3>(8, 4000, false);
+    testDecimator<3>(16, 100000, true);
+    testWindow<1>();
+    testWindow<16>();
+    testWindow<128>();
+
+    if (argc > 1) benchmark();
+
+    return checkResult("trace_test");
+
+}
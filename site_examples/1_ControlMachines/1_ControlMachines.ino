@@ -37,7 +37,6 @@
 NeuroBoard board;
 
 #define MAX 150
-int readings[10];
 int finalReading;
 byte litLEDS = 0;
 byte multiplier = 1;
@@ -47,19 +46,16 @@ void setup() {
 	// Required for gathering samples from the board
     board.startMeasurements();
 
+	// Average over the last 10 samples (~0.04s)
+    board.setWindowSize(10);
+
 }
 
 void loop() {
 
-	// Get 10 readings from the board in ~0.02s
-    for (int i = 0; i < 10; i++) {
-        readings[i] = board.getNewSample() * multiplier;
-        finalReading += readings[i];
-        delay(2);
-    }
-
-	// Average out readings
-    finalReading /= 10;
+	// Average of the last 10 readings, kept up to date by the board
+    finalReading = board.getWindowMean() * multiplier;
+    delay(20);
 
 	// Turn off all LEDs
     for (int i = 0; i < MAX_LEDS; i++) {
@@ -48,8 +48,7 @@ AccelStepper stepper = AccelStepper(MOTOR_INTERFACE_TYPE, STEP, DIR);
 
 #define MAX 60   						// Maximum reading possible. PLAY WITH THIS VALUE!
 #define MAX_STEPS 10 					// This is the maximum number of steps that will advance (You can modify this value).
-int readings[10];  						// Array of readings.
-int finalReading;						// Averaged out reading from readings array.
+int finalReading;						// Average of the last 10 readings.
 byte multiplier = 1;					// Multiplier for analog readings.
 byte numSteps = 0;						// The number of steps to take.
 int currentSteps = 0;					// The current number of steps taken.
@@ -57,18 +56,14 @@ int currentSteps = 0;					// The current number of steps taken.
 void setup() {
 
 	board.startMeasurements();
+	board.setWindowSize(10);			// Average over the last 10 readings.
 	stepper.setMaxSpeed(200);			// The RPMs engine speed is specified.
 
 }
 
 void loop() {
 
-	for (int i = 0; i < 10; i++) {
-		readings[i] = board.getNewSample() * multiplier;
-		finalReading += readings[i];
-	}
-	
-	finalReading /= 10;
+	finalReading = board.getWindowMean() * multiplier;
 	finalReading = constrain(finalReading, 0, MAX);
 	numSteps = map(finalReading, 0, MAX, 0, MAX_STEPS);
 
@@ -92,6 +92,7 @@ byte leds[] = {8, 9, 10, 11, 12, 13};
 void setup() {
 
 	board.startMeasurements();
+	board.setWindowSize(10);										// Average over the last 10 EMG readings.
 
 }
 
@@ -99,13 +100,7 @@ void loop() {
 
 	// Button crap here
 
-	int* reading;													// Array to collect EMG signals from your arm.
-	board.getSamples(&reading, 10);									// Pass array to NeuroBoard to populate with samples.
-	for (int i = 0; i < 10; i++) {
-		finalReading += reading[i];
-	}
-	delete[] reading;												// Free memory. REQUIRED FOR REALLOCATION.
-	finalReading /= 10;
+	finalReading = board.getWindowMean();							// Average of the last 10 EMG readings from your arm.
 	for (int i = 0; i < MAX_LEDS; i++) {
 		board.writeLED(i, OFF);
 	}
@@ -58,6 +58,7 @@ byte a8[8] = { B00000, B11000, B00100, B00010, B00000, B00000, B00000, B00000 };
 void setup() {
 
 	board.startMeasurements();
+	board.setWindowSize(10);							// Average over the last 10 readings.
 
 	screen.begin(16, 2);								// (columns, rows) of LCD screen.
 
@@ -91,13 +92,7 @@ void setup() {
 
 void loop() {
 
-	int* reading;
-	board.getSamples(&reading, 10);
-	for (int i = 0; i < 10; i++) {
-		finalReading += reading[i] * multiplicator;
-	}
-	finalReading /= 10;
-	delete[] reading;
+	finalReading = board.getWindowMean() * multiplicator;
 
 	finalReading = constrain(finalReading, 0, MAX);
 	currentLCD = map(finalReading, 0, MAX, 0, NUMBER_OF_COLUMNS);